@@ -7,56 +7,63 @@
   #include "src/display.h"
   #include "src/api.h"
   #include "src/tasks.h"
+  #include "src/input.h"
+  #include "src/flow.h"
+  #include "src/scanner.h"
+  #include "src/buzzer.h"
+  #include "src/printer.h"
+  #include "src/customer_display.h"
 
 #define BUTTON_PIN 34
 
 void setup() {
   // Filesystem / GM66 scanner on UART0 (RX0/TX0)
   Serial.begin(9600);
-  delay(3000);
   LittleFS.begin();
 
   // Display init
-  lc.shutdown(0, false);
-  lc.setIntensity(0, 15);
-  lc.clearDisplay(0);
-  lc.shutdown(1, false);
-  lc.setIntensity(1, 15);
-  lc.clearDisplay(1);
+  displayInit();
 
   // Mutex initialization
   busyMutex = xSemaphoreCreateMutex();
-  mqttQueueMutex = xSemaphoreCreateMutex();
-  networkBlockMutex = xSemaphoreCreateMutex();
+  initMqttQueue();
+  initHttpSessions();
+  initApiWorker();
+  initTicketFlow();
+  initConfigRefresh();
+  initInput();
+  initOrderWorker();
+  initFlow();
+  initScanner();
+  initBuzzer();
+  initPrinter();
 
-  // WiFi initialization
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
+  // WiFi + MQTT initialization (owned by networkTask from here on)
+  initNetwork();
 
-  initDisplayEspNow();
+  // Cached config lets the counter take orders before the first sync
+  warmStartFromFlash();
 
-  // MQTT initialization
-  mqtt.setServer(mqtt_server, mqtt_port);
-  mqtt.setCallback(mqttCallback);
+  initCustomerDisplay();
 
   // Start tasks
-  xTaskCreatePinnedToCore(mqttPublisherTask, "MqttPublisher", 4096, NULL, 2, NULL, 0);
+  xTaskCreatePinnedToCore(networkTask, "Network", 6144, NULL, 3, NULL, 0);
+  xTaskCreatePinnedToCore(displayRenderTask, "DisplayRender", 4096, NULL, 2, NULL, 1);
   xTaskCreatePinnedToCore(fetchInitTask, "InitFetchBoot", 4096, NULL, 1, NULL, 1);
   xTaskCreatePinnedToCore(ticketFlowTask, "TicketFlow", 8192, NULL, 4, NULL, 0);
   xTaskCreatePinnedToCore(scannerTask, "ScannerTask", 4096, NULL, 3, NULL, 1);
-  xTaskCreatePinnedToCore(breadButtonsTask, "BreadButtons", 4096, NULL, 2, NULL, 1);
-  xTaskCreatePinnedToCore(confirmButtonTask, "ConfirmButton", 2048, NULL, 2, NULL, 1);
-  xTaskCreatePinnedToCore(confirmAnimationTask, "ConfirmAnim", 2048, NULL, 1, NULL, 1);
-  xTaskCreatePinnedToCore(newBreadButtonTask, "NewBreadButton", 4096, NULL, 2, NULL, 1);
+  xTaskCreatePinnedToCore(inputTask, "Input", 2048, NULL, 3, NULL, 1);
+  xTaskCreatePinnedToCore(inputHandlerTask, "InputHandler", 4096, NULL, 2, NULL, 1);
+  xTaskCreatePinnedToCore(orderWorkerTask, "OrderWorker", 6144, NULL, 2, NULL, 1);
+  xTaskCreatePinnedToCore(printerTask, "Printer", 3072, NULL, 1, NULL, 1);
+  xTaskCreatePinnedToCore(customerDisplayTask, "DisplayLink", 3072, NULL, 2, NULL, 0);
   // xTaskCreatePinnedToCore(upcomingBreadTask, "upcomingBreadTask", 4096, NULL, 2, NULL, 1);
 
   pinMode(35, INPUT);
   pinMode(BUTTON_PIN, INPUT);
-  pinMode(BUZZER_PIN, OUTPUT);
-  digitalWrite(BUZZER_PIN, LOW);
 }
 
 void loop() {
-  ensureConnectivity();
   checkDeadlock();
+  delay(100);
 }
@@ -2,83 +2,216 @@
 #include "api.h"
 #include "network.h"
 #include "mqtt.h"
+#include "errors.h"
 #include <Preferences.h>
 #include <ArduinoJson.h>
+#include <esp_crc.h>
 
 // ---------- GLOBAL DATA ----------
 
 Preferences prefs;
-volatile bool init_success = false;
 const char* endpoint_address = "http://noonyar.freebyte.shop:80/hc";
 bool last_show_on_display = false;
 
+// Last applied bread_id -> cook_time map, stored as one blob so a boot can
+// tell a complete, current-layout copy from a torn or stale one
+struct InitDataBlob {
+  uint16_t version;
+  uint16_t count;
+  int32_t ids[MAX_KEYS];
+  int32_t times[MAX_KEYS];
+  uint32_t crc;               // over everything above
+};
+
+static uint32_t initDataCrc(const InitDataBlob& blob) {
+  return esp_crc32_le(0, (const uint8_t*)&blob, offsetof(InitDataBlob, crc));
+}
+
 void saveInitDataToFlash() {
+  InitDataBlob blob;
+  memset(&blob, 0, sizeof(blob));
+  blob.version = INIT_DATA_VERSION;
+  blob.count = bread_count;
+  for (int i = 0; i < bread_count && i < MAX_KEYS; i++) {
+    blob.ids[i] = breads_id[i];
+    blob.times[i] = bread_cook_time[i];
+  }
+  blob.crc = initDataCrc(blob);
+
   if (!prefs.begin("bakery_data", false)) return;
-  prefs.putInt("cnt", bread_count);
-  char key[8];
-  for (int i = 0; i < bread_count; i++) {
-    snprintf(key, sizeof(key), "k%d", i);
-    prefs.putInt(key, breads_id[i]);
-    snprintf(key, sizeof(key), "v%d", i);
-    prefs.putInt(key, bread_cook_time[i]);
+  // Drop the old per-key layout (cnt, k<i>, v<i>) once
+  if (prefs.isKey("cnt")) prefs.clear();
+
+  // Unchanged config (the usual bread_time refresh) costs no flash write
+  InitDataBlob stored;
+  if (prefs.getBytesLength("init") != sizeof(stored) ||
+      prefs.getBytes("init", &stored, sizeof(stored)) != sizeof(stored) ||
+      memcmp(&stored, &blob, sizeof(blob)) != 0) {
+    prefs.putBytes("init", &blob, sizeof(blob));
+  }
+  prefs.end();
+}
+
+bool loadInitDataFromFlash() {
+  InitDataBlob blob;
+  bool ok = false;
+
+  if (!prefs.begin("bakery_data", true)) return false;
+  if (prefs.getBytesLength("init") == sizeof(blob) &&
+      prefs.getBytes("init", &blob, sizeof(blob)) == sizeof(blob)) {
+    ok = blob.version == INIT_DATA_VERSION &&
+         blob.count > 0 && blob.count <= MAX_KEYS &&
+         blob.crc == initDataCrc(blob);
   }
   prefs.end();
+  if (!ok) return false;
+
+  for (int i = 0; i < blob.count; i++) {
+    breads_id[i] = blob.ids[i];
+    bread_cook_time[i] = blob.times[i];
+  }
+  bread_count = blob.count;
+  return true;
 }
 
 
+// ---------- PER-ENDPOINT HEAP ACCOUNTING ----------
+static const char* const apiEndpointNames[API_ENDPOINT_COUNT] = {
+  "hardware_init", "new_ticket", "new_bread", "current_cook_customer",
+  "serve_ticket", "current_ticket", "wait_list"
+};
+static ApiHeapStats apiHeapStats[API_ENDPOINT_COUNT];
+
+static void recordApiHeap(ApiEndpoint ep, const HttpJsonResponse& resp) {
+  ApiHeapStats& st = apiHeapStats[ep];
+  st.calls++;
+  st.last_bytes = resp.heap_used;
+  if (resp.heap_used > st.max_bytes) st.max_bytes = resp.heap_used;
+}
+
+const char* apiEndpointName(ApiEndpoint ep) {
+  return apiEndpointNames[ep];
+}
+
+ApiHeapStats getApiHeapStats(ApiEndpoint ep) {
+  return apiHeapStats[ep];
+}
+
 bool fetchInitData() {
-  HttpResponse resp = sendHttpRequest((String(endpoint_address) + "/hardware_init?bakery_id=" + bakery_id), "GET", "", INIT_HTTP_TIMEOUT);
+  // The whole body is the bread_id -> cook_time map, so no filter here
+  StaticJsonDocument<768> doc;
+  HttpJsonResponse resp = sendHttpRequestJson((String(endpoint_address) + "/hardware_init?bakery_id=" + bakery_id), "GET", "", &doc, NULL, INIT_HTTP_TIMEOUT);
+  recordApiHeap(API_EP_HARDWARE_INIT, resp);
 
-  if (resp.body.isEmpty() || resp.status_code != 200) {
-    mqttPublishError("api:apiSendTicketToWaitList:failed:empty body or invalid status_code (code=" + String(resp.status_code) + " | body= " + String(resp.body) + ")");
+  if (resp.status_code != 200) {
+    reportError(ERR_API_INIT_HTTP, resp.status_code);
     return false;
   }
 
-  StaticJsonDocument<768> doc;
-  DeserializationError err = deserializeJson(doc, resp.body);
-  if (err) { 
-    mqttPublishError(String("api:fetchInitData:error: ") + err.c_str() + String(" | Body: ") + String(resp.body)); 
+  if (resp.error) { 
+    reportError(ERR_API_INIT_JSON, resp.error.code());
     return false; 
   }
 
-  bread_count = 0;
-  for (JsonPair kv : doc.as<JsonObject>()) {
-    if (bread_count >= MAX_KEYS) break;
-    breads_id[bread_count] = String(kv.key().c_str()).toInt();
-    bread_cook_time[bread_count] = kv.value().as<int>();
-    bread_count++;
-  }
+  int ids[MAX_KEYS];
+  int times[MAX_KEYS];
+  // Nothing else to fall back on at init: keep the good entries
+  int n = parseBreadTimeMap(doc.as<JsonObjectConst>(), ids, times, false);
+
+  applyBreadTimes(ids, times, n);
   Serial.print(String(bread_count));
+  return true;
+}
+
+// Shared by /hardware_init and the inline bread_time MQTT payload. Returns
+// the number of entries. Strict (an MQTT delta, the current config still
+// stands): -1 if anything is not bread_id -> integer. Otherwise such entries
+// are reported and skipped.
+int parseBreadTimeMap(JsonObjectConst map, int* ids, int* times, bool strict) {
+  int n = 0;
+  for (JsonPairConst kv : map) {
+    if (n >= MAX_KEYS) break;
+    int id = atoi(kv.key().c_str());
+    if (id <= 0 || !kv.value().is<int>()) {
+      if (strict) return -1;
+      reportError(ERR_API_INIT_BAD_ENTRY, id);
+      continue;
+    }
+    ids[n] = id;
+    times[n] = kv.value().as<int>();
+    n++;
+  }
+  return n;
+}
+
+// Replaces the whole config; only for a full /hardware_init snapshot
+void applyBreadTimes(const int* ids, const int* times, int n) {
+  for (int i = 0; i < n; i++) {
+    breads_id[i] = ids[i];
+    bread_cook_time[i] = times[i];
+  }
+  bread_count = n;
+  saveInitDataToFlash();
+}
+
+// Updates the cook time of breads already in the config and leaves the rest
+// alone. Returns false, changing nothing, if an id is not configured: the
+// bread layout changed and only a full refetch can say where it goes.
+bool mergeBreadTimes(const int* ids, const int* times, int n) {
+  int slots[MAX_KEYS];
+  for (int i = 0; i < n; i++) {
+    slots[i] = -1;
+    for (int k = 0; k < bread_count; k++) {
+      if (breads_id[k] == ids[i]) {
+        slots[i] = k;
+        break;
+      }
+    }
+    if (slots[i] < 0) return false;
+  }
+
+  for (int i = 0; i < n; i++) {
+    bread_cook_time[slots[i]] = times[i];
+  }
   saveInitDataToFlash();
   return true;
 }
 
-int apiNewCustomer(const std::vector<int>& breads) {
+// ---------- BLOCKING REQUEST BODIES (run on the API worker) ----------
+
+static int runNewCustomer(const int* breads, int breadLen) {
   // Reset flags for this call
   last_show_on_display = false;
   StaticJsonDocument<512> bodyDoc;
   bodyDoc["bakery_id"] = atoi(bakery_id);
   JsonObject req = bodyDoc.createNestedObject("bread_requirements");
   for (int i = 0; i < bread_count; ++i) {
-    req[String(breads_id[i])] = (i < (int)breads.size() ? breads[i] : 0);
+    req[String(breads_id[i])] = (i < breadLen ? breads[i] : 0);
   }
   String body; serializeJson(bodyDoc, body);
 
-  HttpResponse resp = sendHttpRequest((String(endpoint_address) + "/new_ticket"), "POST", body);
-  if (resp.body.isEmpty() || resp.status_code != 200) {
-    mqttPublishError("api:apiNewCustomer:failed: empty body or invalid status_code (code=" + String(resp.status_code) + " | body= " + String(resp.body) + ")");
+  static StaticJsonDocument<64> filter;
+  if (filter.isNull()) {
+    filter["customer_ticket_id"] = true;
+    filter["show_on_display"] = true;
+  }
+
+  StaticJsonDocument<128> doc;
+  HttpJsonResponse resp = sendHttpRequestJson((String(endpoint_address) + "/new_ticket"), "POST", body, &doc, &filter);
+  recordApiHeap(API_EP_NEW_TICKET, resp);
+
+  if (resp.status_code != 200) {
+    reportError(ERR_API_NEW_CUSTOMER_HTTP, resp.status_code);
     return -1;
   }
 
-  StaticJsonDocument<256> doc;
-  DeserializationError err = deserializeJson(doc, resp.body);
-  if (err) { 
-    mqttPublishError(String("api:apiNewCustomer:error: ") + err.c_str() + String(" | Body: ") + String(resp.body)); 
+  if (resp.error) { 
+    reportError(ERR_API_NEW_CUSTOMER_JSON, resp.error.code());
     return -1; 
   }
 
   if (!doc.containsKey("customer_ticket_id")) {
-    mqttPublishError("api:apiNewCustomer:missing customer_ticket_id" + String(" | Body: ") + String(resp.body));
+    reportError(ERR_API_NEW_CUSTOMER_NO_ID);
     return -1;
   }
 
@@ -88,20 +221,27 @@ int apiNewCustomer(const std::vector<int>& breads) {
   return doc["customer_ticket_id"].as<int>();
 }
 
-NewBreadResponse apiNewBread() {
+static NewBreadResponse runNewBread() {
   NewBreadResponse r;
 
-  HttpResponse resp = sendHttpRequest((String(endpoint_address) + "/new_bread/" + bakery_id), "POST", "");
-  if (resp.body.isEmpty() || resp.status_code != 200) {
-    mqttPublishError("api:apiNewBread:failed: empty body or invalid status_code (code=" + String(resp.status_code) + " | body= " + String(resp.body) + ")");
+  static StaticJsonDocument<64> filter;
+  if (filter.isNull()) {
+    filter["bread_index"] = true;
+    filter["customer_breads"] = true;
+  }
+
+  StaticJsonDocument<256> doc;
+  HttpJsonResponse resp = sendHttpRequestJson((String(endpoint_address) + "/new_bread/" + bakery_id), "POST", "", &doc, &filter);
+  recordApiHeap(API_EP_NEW_BREAD, resp);
+
+  if (resp.status_code != 200) {
+    reportError(ERR_API_NEW_BREAD_HTTP, resp.status_code);
     r.error = "http_fail";
     return r;
   }
 
-  StaticJsonDocument<512> doc;
-  DeserializationError err = deserializeJson(doc, resp.body);
-  if (err) {
-    mqttPublishError(String("api:apiNewBread:error: ") + err.c_str() + String(" | Body: ") + String(resp.body));
+  if (resp.error) {
+    reportError(ERR_API_NEW_BREAD_JSON, resp.error.code());
     r.error = "json_error";
     return r;
   }
@@ -123,17 +263,23 @@ NewBreadResponse apiNewBread() {
 }
 
 bool apiInitCookDisplayFromServer() {
-  HttpResponse resp = sendHttpRequest((String(endpoint_address) + "/current_cook_customer/" + bakery_id), "GET");
+  static StaticJsonDocument<64> filter;
+  if (filter.isNull()) {
+    filter["has_customer"] = true;
+    filter["customer_breads"] = true;
+  }
+
+  StaticJsonDocument<256> doc;
+  HttpJsonResponse resp = sendHttpRequestJson((String(endpoint_address) + "/current_cook_customer/" + bakery_id), "GET", "", &doc, &filter);
+  recordApiHeap(API_EP_COOK_CUSTOMER, resp);
 
-  if (resp.body.isEmpty() || resp.status_code != 200) {
-    mqttPublishError("api:apiInitCookDisplayFromServer:failed: empty body or invalid status_code (code=" + String(resp.status_code) + " | body= " + String(resp.body) + ")");
+  if (resp.status_code != 200) {
+    reportError(ERR_API_COOK_DISPLAY_HTTP, resp.status_code);
     return false;
   }
 
-  StaticJsonDocument<512> doc;
-  DeserializationError err = deserializeJson(doc, resp.body);
-  if (err) {
-    mqttPublishError(String("api:apiInitCookDisplayFromServer:error: ") + err.c_str() + String(" | Body: ") + String(resp.body));
+  if (resp.error) {
+    reportError(ERR_API_COOK_DISPLAY_JSON, resp.error.code());
     return false;
   }
 
@@ -160,11 +306,11 @@ bool apiInitCookDisplayFromServer() {
   }
 
   // If we reach here, we had a successful HTTP/JSON but no useful payload
-  mqttPublishError("api:apiInitCookDisplayFromServer:missing customer_breads in response | Body: " + String(resp.body));
+  reportError(ERR_API_COOK_DISPLAY_NO_DATA);
   return false;
 }
 
-ServeTicketResponse apiServeTicket(int customer_ticket_id) {
+static ServeTicketResponse runServeTicket(int customer_ticket_id) {
   ServeTicketResponse r;
 
   StaticJsonDocument<256> bodyDoc;
@@ -172,23 +318,30 @@ ServeTicketResponse apiServeTicket(int customer_ticket_id) {
   bodyDoc["customer_ticket_id"] = customer_ticket_id;
   String body; serializeJson(bodyDoc, body);
 
-  HttpResponse resp = sendHttpRequest((String(endpoint_address) + "/serve_ticket"), "PUT", body);
+  static StaticJsonDocument<96> filter;
+  if (filter.isNull()) {
+    filter["current_ticket_id"] = true;
+    filter["skipped_customer"] = true;
+    filter["user_detail"] = true;
+  }
+
+  StaticJsonDocument<384> doc;
+  HttpJsonResponse resp = sendHttpRequestJson((String(endpoint_address) + "/serve_ticket"), "PUT", body, &doc, &filter);
+  recordApiHeap(API_EP_SERVE_TICKET, resp);
 
   if (resp.status_code == 404) {
     r.error = "ticket_is_not_in_wait_list";
     return r;
   }
 
-  if (resp.body.isEmpty() || resp.status_code != 200) {
-    mqttPublishError("api:apiNextTicket:failed: empty body or invalid status_code  (code=" + String(resp.status_code) + " | body= " + String(resp.body) + ")");
+  if (resp.status_code != 200) {
+    reportError(ERR_API_SERVE_TICKET_HTTP, resp.status_code);
     r.error = "http_fail";
     return r;
   }
 
-  StaticJsonDocument<768> doc;
-  DeserializationError err = deserializeJson(doc, resp.body);
-  if (err) { 
-    mqttPublishError(String("api:apiNextTicket:error:") + err.c_str() + String(" | Body: ") + String(resp.body)); 
+  if (resp.error) { 
+    reportError(ERR_API_SERVE_TICKET_JSON, resp.error.code());
     r.error = "json_error";
     return r;
   }
@@ -209,35 +362,17 @@ ServeTicketResponse apiServeTicket(int customer_ticket_id) {
   return r;
 }
 
-CurrentTicketResponse apiCurrentTicket() {
-  CurrentTicketResponse r;
-
-  HttpResponse resp = sendHttpRequest((String(endpoint_address) + "/current_ticket/" + bakery_id), "GET");
-
-  if (resp.body.isEmpty() || resp.status_code != 200) {
-    mqttPublishError("api:apiCurrentTicket:failed: empty body or invalid status_code  (code=" + String(resp.status_code) + " | body= " + String(resp.body) + ")");
-    r.error = "http_fail";
-    return r;
-  }
-
-  StaticJsonDocument<768> doc;
-  DeserializationError err = deserializeJson(doc, resp.body);
-  if (err) {
-    mqttPublishError(String("api:apiCurrentTicket:error:") + err.c_str() + String(" | Body: ") + String(resp.body)); 
-    r.error = "json_error";
-    return r;
-  }
-  
+void parseCurrentTicketState(JsonVariantConst doc, CurrentTicketState& r) {
   bool ready = doc["ready"] | false;
   r.ready = ready;
   r.wait_until = doc["wait_until"] | -1;
   r.has_customer_in_queue = doc["has_customer_in_queue"] | true;
   r.current_ticket_id = doc["current_ticket_id"] | -1;
+  r.bread_count = 0;
   if (ready == true){
-    if (doc.containsKey("current_user_detail") && doc["current_user_detail"].is<JsonObject>()) {
-      JsonObject detail = doc["current_user_detail"].as<JsonObject>();
-      r.bread_count = 0;
-      for (JsonPair kv : detail) {
+    if (doc.containsKey("current_user_detail") && doc["current_user_detail"].is<JsonObjectConst>()) {
+      JsonObjectConst detail = doc["current_user_detail"].as<JsonObjectConst>();
+      for (JsonPairConst kv : detail) {
         if (r.bread_count < MAX_KEYS) {
           r.breads[r.bread_count] = String(kv.key().c_str()).toInt();
           r.bread_counts[r.bread_count] = kv.value().as<int>();
@@ -246,18 +381,209 @@ CurrentTicketResponse apiCurrentTicket() {
       }
     }
   }
+}
+
+static CurrentTicketResponse runCurrentTicket() {
+  CurrentTicketResponse r;
+
+  static StaticJsonDocument<128> filter;
+  if (filter.isNull()) {
+    filter["ready"] = true;
+    filter["wait_until"] = true;
+    filter["has_customer_in_queue"] = true;
+    filter["current_ticket_id"] = true;
+    filter["current_user_detail"] = true;
+  }
+
+  StaticJsonDocument<384> doc;
+  HttpJsonResponse resp = sendHttpRequestJson((String(endpoint_address) + "/current_ticket/" + bakery_id), "GET", "", &doc, &filter);
+  recordApiHeap(API_EP_CURRENT_TICKET, resp);
+
+  if (resp.status_code != 200) {
+    reportError(ERR_API_CURRENT_TICKET_HTTP, resp.status_code);
+    r.error = "http_fail";
+    return r;
+  }
+
+  if (resp.error) {
+    reportError(ERR_API_CURRENT_TICKET_JSON, resp.error.code());
+    r.error = "json_error";
+    return r;
+  }
+  
+  parseCurrentTicketState(doc.as<JsonVariantConst>(), r);
   return r;
 }
 
+// ---------- ASYNC REQUEST ENGINE ----------
+// One worker task owns every request submitted through apiSubmit(), so the
+// input tasks hand off their call and keep running while HTTP retries happen.
+
+static QueueHandle_t apiRequestQueue = NULL;
+static TaskHandle_t apiWorkerHandle = NULL;
+
+static void executeApiRequest(const ApiRequest& req, ApiResult& result) {
+  result.type = req.type;
+  switch (req.type) {
+    case API_NEW_CUSTOMER:
+      result.customer_ticket_id = runNewCustomer(req.breads, req.bread_count);
+      result.show_on_display = last_show_on_display;
+      break;
+    case API_SERVE_TICKET:
+      result.serve = runServeTicket(req.ticket_id);
+      break;
+    case API_NEW_BREAD:
+      result.new_bread = runNewBread();
+      break;
+    case API_CURRENT_TICKET:
+      result.current = runCurrentTicket();
+      break;
+  }
+}
+
+static void apiWorkerTask(void* param) {
+  static ApiResult workerResult;
+  ApiRequest req;
+
+  while (true) {
+    if (xQueueReceive(apiRequestQueue, &req, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    ApiResult& result = req.result ? *req.result : workerResult;
+    result = ApiResult();
+    executeApiRequest(req, result);
+
+    if (req.callback) {
+      req.callback(result, req.ctx);
+    }
+    if (req.notify_task) {
+      xTaskNotifyGive(req.notify_task);
+    }
+  }
+}
+
+void initApiWorker() {
+  if (apiRequestQueue) return;
+  apiRequestQueue = xQueueCreate(API_QUEUE_DEPTH, sizeof(ApiRequest));
+  xTaskCreatePinnedToCore(apiWorkerTask, "ApiWorker", 8192, NULL, 3, &apiWorkerHandle, 0);
+}
+
+bool apiSubmit(const ApiRequest& req) {
+  if (!apiRequestQueue) return false;
+  if (xQueueSend(apiRequestQueue, &req, (TickType_t)0) != pdTRUE) {
+    reportError(ERR_API_QUEUE_FULL, req.type);
+    return false;
+  }
+  return true;
+}
+
+int getApiQueueDepth() {
+  return apiRequestQueue ? (int)uxQueueMessagesWaiting(apiRequestQueue) : 0;
+}
+
+static bool submitWithNotify(ApiRequest& req, ApiResult* out, TaskHandle_t notifyTask,
+                             ApiCallback callback = NULL, void* ctx = NULL) {
+  req.result = out;
+  req.notify_task = notifyTask;
+  req.callback = callback;
+  req.ctx = ctx;
+  return apiSubmit(req);
+}
+
+bool apiNewCustomerAsync(const std::vector<int>& breads, ApiResult* out, TaskHandle_t notifyTask,
+                         ApiCallback callback, void* ctx) {
+  ApiRequest req;
+  req.type = API_NEW_CUSTOMER;
+  req.bread_count = 0;
+  for (size_t i = 0; i < breads.size() && req.bread_count < MAX_KEYS; ++i) {
+    req.breads[req.bread_count++] = breads[i];
+  }
+  return submitWithNotify(req, out, notifyTask, callback, ctx);
+}
+
+bool apiServeTicketAsync(int customer_ticket_id, ApiResult* out, TaskHandle_t notifyTask) {
+  ApiRequest req;
+  req.type = API_SERVE_TICKET;
+  req.ticket_id = customer_ticket_id;
+  return submitWithNotify(req, out, notifyTask);
+}
+
+bool apiNewBreadAsync(ApiResult* out, TaskHandle_t notifyTask, ApiCallback callback, void* ctx) {
+  ApiRequest req;
+  req.type = API_NEW_BREAD;
+  return submitWithNotify(req, out, notifyTask, callback, ctx);
+}
+
+bool apiCurrentTicketAsync(ApiResult* out, TaskHandle_t notifyTask) {
+  ApiRequest req;
+  req.type = API_CURRENT_TICKET;
+  return submitWithNotify(req, out, notifyTask);
+}
+
+// Blocking form used by tasks that have nothing else to do while waiting.
+// Called from the worker itself (e.g. inside a callback) it runs inline.
+static ApiResult apiCallBlocking(ApiRequest& req) {
+  ApiResult result;
+  if (apiRequestQueue == NULL || xTaskGetCurrentTaskHandle() == apiWorkerHandle) {
+    executeApiRequest(req, result);
+    return result;
+  }
+
+  if (!submitWithNotify(req, &result, xTaskGetCurrentTaskHandle())) {
+    result.type = req.type;
+    result.serve.error = "queue_full";
+    result.current.error = "queue_full";
+    result.new_bread.error = "queue_full";
+    return result;
+  }
+
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  return result;
+}
+
+int apiNewCustomer(const std::vector<int>& breads) {
+  ApiRequest req;
+  req.type = API_NEW_CUSTOMER;
+  req.bread_count = 0;
+  for (size_t i = 0; i < breads.size() && req.bread_count < MAX_KEYS; ++i) {
+    req.breads[req.bread_count++] = breads[i];
+  }
+  ApiResult result = apiCallBlocking(req);
+  last_show_on_display = result.show_on_display;
+  return result.customer_ticket_id;
+}
+
+NewBreadResponse apiNewBread() {
+  ApiRequest req;
+  req.type = API_NEW_BREAD;
+  return apiCallBlocking(req).new_bread;
+}
+
+ServeTicketResponse apiServeTicket(int customer_ticket_id) {
+  ApiRequest req;
+  req.type = API_SERVE_TICKET;
+  req.ticket_id = customer_ticket_id;
+  return apiCallBlocking(req).serve;
+}
+
+CurrentTicketResponse apiCurrentTicket() {
+  ApiRequest req;
+  req.type = API_CURRENT_TICKET;
+  return apiCallBlocking(req).current;
+}
+
 bool apiSendTicketToWaitList(int customer_ticket_id) {
   StaticJsonDocument<256> bodyDoc;
   bodyDoc["bakery_id"] = atoi(bakery_id);
   bodyDoc["customer_ticket_id"] = customer_ticket_id;
   String body; serializeJson(bodyDoc, body);
 
-  HttpResponse resp = sendHttpRequest((String(endpoint_address) + "/send_current_ticket_to_wait_list/" + String(bakery_id)), "PUT", body);
-  if (resp.body.isEmpty() || resp.status_code != 200) {
-    mqttPublishError("api:apiSendTicketToWaitList:failed:empty body or invalid status_code  (code=" + String(resp.status_code) + " | body= " + String(resp.body) + ")");
+  // Only the status matters; the body is discarded as it streams in
+  HttpJsonResponse resp = sendHttpRequestJson((String(endpoint_address) + "/send_current_ticket_to_wait_list/" + String(bakery_id)), "PUT", body, NULL, NULL);
+  recordApiHeap(API_EP_WAIT_LIST, resp);
+  if (resp.status_code != 200) {
+    reportError(ERR_API_WAIT_LIST_HTTP, resp.status_code);
     return false; 
   }
 
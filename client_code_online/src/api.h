@@ -3,18 +3,52 @@
 
 #include "config.h"
 #include "types.h"
+#include <ArduinoJson.h>
 
 // ---------- GLOBAL DATA ----------
-extern volatile bool init_success;
 extern const char* endpoint_address;
 extern bool last_show_on_display;
 
+// ---------- ASYNC REQUEST ENGINE ----------
+void initApiWorker();
+bool apiSubmit(const ApiRequest& req);
+int getApiQueueDepth();
+
+// Submit without blocking. On completion `out` (if given) holds the result,
+// `callback` (if given) runs on the worker and `notifyTask` (if given)
+// receives a task notification.
+bool apiNewCustomerAsync(const std::vector<int>& breads, ApiResult* out, TaskHandle_t notifyTask,
+                         ApiCallback callback = NULL, void* ctx = NULL);
+bool apiServeTicketAsync(int customer_ticket_id, ApiResult* out, TaskHandle_t notifyTask);
+bool apiNewBreadAsync(ApiResult* out, TaskHandle_t notifyTask, ApiCallback callback = NULL, void* ctx = NULL);
+bool apiCurrentTicketAsync(ApiResult* out, TaskHandle_t notifyTask);
+
+// ---------- PER-ENDPOINT HEAP ACCOUNTING ----------
+enum ApiEndpoint : uint8_t {
+  API_EP_HARDWARE_INIT,
+  API_EP_NEW_TICKET,
+  API_EP_NEW_BREAD,
+  API_EP_COOK_CUSTOMER,
+  API_EP_SERVE_TICKET,
+  API_EP_CURRENT_TICKET,
+  API_EP_WAIT_LIST,
+  API_ENDPOINT_COUNT
+};
+
+const char* apiEndpointName(ApiEndpoint ep);
+ApiHeapStats getApiHeapStats(ApiEndpoint ep);
+
 // ---------- API FUNCTIONS ----------
 bool fetchInitData();
+int parseBreadTimeMap(JsonObjectConst map, int* ids, int* times, bool strict = true);
+void applyBreadTimes(const int* ids, const int* times, int n);
+bool mergeBreadTimes(const int* ids, const int* times, int n);
 int apiNewCustomer(const std::vector<int>& breads);
 ServeTicketResponse apiServeTicket(int customer_ticket_id);
 CurrentTicketResponse apiCurrentTicket();
 bool apiSendTicketToWaitList(int customer_ticket_id);
+// Same JSON shape as /current_ticket, also used for the MQTT push
+void parseCurrentTicketState(JsonVariantConst doc, CurrentTicketState& r);
 NewBreadResponse apiNewBread();
 bool apiInitCookDisplayFromServer();
 // bool isTicketInSkippedList(int customer_ticket_id);
@@ -22,5 +56,6 @@ bool apiInitCookDisplayFromServer();
 // bool apiUpdateTimeout(int time_out_minute);
 // ---------- STORAGE FUNCTIONS ----------
 void saveInitDataToFlash();
+bool loadInitDataFromFlash();   // false when missing, wrong version or corrupt
 
 #endif
@@ -0,0 +1,97 @@
+#include "buzzer.h"
+#include <esp_timer.h>
+
+// Alternating on/off durations in ms, starting with on, 0-terminated
+static const uint16_t successSteps[]   = { 300, 0 };
+static const uint16_t rejectedSteps[]  = { 200, 100, 200, 100, 200, 0 };
+static const uint16_t duplicateSteps[] = { 80, 0 };
+static const uint16_t errorSteps[]     = { 600, 150, 600, 0 };
+static const uint16_t confirmSteps[]   = { 40, 0 };
+
+struct BuzzerPatternDef {
+  uint8_t priority;          // a pattern only preempts one of equal or lower priority
+  const uint16_t* steps;
+};
+
+// Indexed by BuzzerPattern
+static const BuzzerPatternDef buzzerPatterns[] = {
+  { 2, successSteps },    // BUZZER_SUCCESS
+  { 3, rejectedSteps },   // BUZZER_REJECTED
+  { 1, duplicateSteps },  // BUZZER_DUPLICATE
+  { 3, errorSteps },      // BUZZER_ERROR
+  { 1, confirmSteps },    // BUZZER_CONFIRM
+};
+
+static esp_timer_handle_t buzzerTimer = NULL;
+static portMUX_TYPE buzzerMux = portMUX_INITIALIZER_UNLOCKED;
+static const BuzzerPatternDef* buzzerPlaying = NULL;
+static uint8_t buzzerStep = 0;
+static uint8_t buzzerStaleFirings = 0;   // firings of a replaced pattern still to come
+static BuzzerStats buzzerStats;
+
+// Drives step `buzzerStep` of buzzerPlaying, or silences and goes idle.
+// Called with buzzerMux held.
+static void runStep() {
+  if (!buzzerPlaying || buzzerPlaying->steps[buzzerStep] == 0) {
+    digitalWrite(BUZZER_PIN, LOW);
+    buzzerPlaying = NULL;
+    return;
+  }
+  digitalWrite(BUZZER_PIN, (buzzerStep % 2 == 0) ? HIGH : LOW);
+  esp_timer_start_once(buzzerTimer, (uint64_t)buzzerPlaying->steps[buzzerStep] * 1000);
+}
+
+// esp_timer task
+static void buzzerTimerCallback(void* arg) {
+  portENTER_CRITICAL(&buzzerMux);
+  if (buzzerStaleFirings > 0) {
+    // Fired for the pattern buzzerPlay() replaced; not a step of this one
+    buzzerStaleFirings--;
+  } else if (buzzerPlaying) {
+    buzzerStep++;
+    runStep();
+  }
+  portEXIT_CRITICAL(&buzzerMux);
+}
+
+void initBuzzer() {
+  pinMode(BUZZER_PIN, OUTPUT);
+  digitalWrite(BUZZER_PIN, LOW);
+
+  esp_timer_create_args_t args = {};
+  args.callback = buzzerTimerCallback;
+  args.name = "buzzer";
+  esp_timer_create(&args, &buzzerTimer);
+}
+
+bool buzzerPlay(BuzzerPattern pattern) {
+  if (!buzzerTimer || pattern >= sizeof(buzzerPatterns) / sizeof(buzzerPatterns[0])) return false;
+  const BuzzerPatternDef* def = &buzzerPatterns[pattern];
+
+  portENTER_CRITICAL(&buzzerMux);
+  if (buzzerPlaying && buzzerPlaying->priority > def->priority) {
+    buzzerStats.ignored++;
+    portEXIT_CRITICAL(&buzzerMux);
+    return false;
+  }
+  if (buzzerPlaying) {
+    buzzerStats.preempted++;
+    // A timer that is no longer running has already fired: its callback is
+    // waiting on buzzerMux and must not advance the new pattern
+    if (esp_timer_stop(buzzerTimer) != ESP_OK) buzzerStaleFirings++;
+  }
+  buzzerStats.played++;
+  buzzerPlaying = def;
+  buzzerStep = 0;
+  runStep();
+  portEXIT_CRITICAL(&buzzerMux);
+  return true;
+}
+
+BuzzerStats getBuzzerStats() {
+  portENTER_CRITICAL(&buzzerMux);
+  BuzzerStats st = buzzerStats;
+  buzzerStats = BuzzerStats();
+  portEXIT_CRITICAL(&buzzerMux);
+  return st;
+}
@@ -0,0 +1,13 @@
+#ifndef BUZZER_H
+#define BUZZER_H
+
+#include "config.h"
+#include "types.h"
+
+// ---------- BUZZER ----------
+// Patterns play from an esp_timer; buzzerPlay() only starts them and returns
+void initBuzzer();
+bool buzzerPlay(BuzzerPattern pattern);   // false when a higher priority pattern is playing
+BuzzerStats getBuzzerStats();
+
+#endif
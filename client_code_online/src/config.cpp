@@ -15,10 +15,6 @@ bool hasCustomerScanned = false;
 volatile int currentTicketID = -1;
 bool readyToScan = false;
 bool exitWaitTimeout = false;
-bool confirmationMode = false;
-bool confirmationAccepted = false;
-bool uploadInProgress = false;
-bool deliveryPending = false;
 
 unsigned long bakery_timeout_ms = 0;
 unsigned long lastConnectivityCheck = 0;
@@ -49,7 +45,5 @@ int bread1_cook_display = 0;
 int bread2_cook_display = 0;
 int bread3_cook_display = 0;
 
-int displayMode = DISPLAY_MODE_NONE;
-
 int max_total_breads = 5;
 
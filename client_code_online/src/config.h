@@ -6,15 +6,60 @@
 // ---------- HARDWARE CONFIG ----------
 #define MAX_KEYS            10
 #define MAX_HTTP_RETRIES    3
-#define MAX_MQTT_QUEUE_SIZE 50
+#define MQTT_RING_SIZE      32    // power of two
+#define MQTT_SLOT_PAYLOAD_SIZE 192
+#define HTTP_SESSION_POOL_SIZE 2
+#define API_QUEUE_DEPTH     8
+#define MQTT_BUFFER_SIZE    2560  // fits the full stats payload
 
 // MAX7219 pins
 #define DIN_PIN  23
 #define CLK_PIN  18
 #define CS_PIN   5
+#define DISPLAY_DEVICES 2   // chained MAX7219s
+
+// MAX7219 backend: bit-banged shiftOut() or the VSPI peripheral with DMA
+// (DIN/CLK/CS above are the VSPI MOSI/SCLK/CS pins)
+#define DISPLAY_BACKEND_BITBANG 0
+#define DISPLAY_BACKEND_SPI     1
+#ifndef DISPLAY_BACKEND
+#define DISPLAY_BACKEND DISPLAY_BACKEND_SPI
+#endif
+#define DISPLAY_SPI_CLOCK_HZ 5000000   // MAX7219 tops out at 10 MHz
+#define DISPLAY_QUEUE_DEPTH 16
+#define DISPLAY_FRAME_MS    20
+#define CONFIRM_ANIM_STEP_MS 100
 #define RXD2 16
 #define TXD2 17
 
+// GM66 QR scanner on Serial (UART0)
+#define SCANNER_LINE_MAX     128  // longest code kept; longer lines are discarded
+#define SCANNER_RX_TIMEOUT   10   // idle byte times that end a code (GM66 may send no CR/LF)
+#define SCANNER_QUEUE_DEPTH  4
+#define TICKET_CACHE_SIZE          8
+#define TICKET_SERVED_TTL_MS       300000UL  // re-scans of a served ticket never reach the API
+#define TICKET_REJECTED_TTL_MS     30000UL   // not-in-wait-list may change once the customer registers
+#define WAIT_LIST_MIRROR_SIZE      16
+#define WAIT_LIST_TTL_MS           1800000UL // entries nobody scanned or removed are dropped
+#define SERVE_TICKET_ATTEMPTS      3         // serve requests for a delivery already shown from the mirror
+#define SERVE_TICKET_RETRY_MS      2000
+
+// Customer display link (ESP-NOW)
+#define DISPLAY_LINK_QUEUE_DEPTH   8
+#define DISPLAY_FRAME_MAX_UPDATES  8
+#define DISPLAY_LINK_MAX_CALLS     DISPLAY_FRAME_MAX_UPDATES  // unacknowledged calls kept; overflow drops the oldest and is reported
+#define DISPLAY_ACK_TIMEOUT_MS     60     // doubled per retransmit
+#define DISPLAY_ACK_TIMEOUT_MAX_MS 1000
+#define DISPLAY_LINK_MAX_RETRIES   5      // then re-add the peer and back off
+#define DISPLAY_LINK_BACKOFF_MS    5000
+#define DISPLAY_LINK_ACKED         0      // 1: the display firmware ACKs frames; 0: wait for its first ACK
+
+// CSN-A2 printer on UART1
+#define PRINTER_BAUD         19200
+#define PRINTER_QUEUE_DEPTH  8
+#define PRINTER_CLOSE_WAIT_MS 500  // how long FINISH/VOID of a begun ticket may wait for space
+#define PRINTER_BUFFER_SIZE  256   // one rendered job
+
 // Buzzer pin
 #define BUZZER_PIN 19
 
@@ -24,6 +69,15 @@
 // New bread button pin (pullup on GPIO34)
 #define NEW_BREAD_BUTTON_PIN 34
 
+// Input subsystem
+#define INPUT_SCAN_MS            10   // scan period while any key is down; debounce = 4 scans
+#define INPUT_REPEAT_DELAY_MS    500  // +/- held this long starts auto-repeat
+#define INPUT_REPEAT_MS          150
+#define INPUT_EVENT_QUEUE_DEPTH  16
+#define ORDER_QUEUE_DEPTH        4
+#define ORDER_NET_WAIT_MS        15000  // an order waits this long for the API, then the keypad stops taking orders
+#define FLOW_LOG_SIZE            16   // flow transitions kept for flowPrintLog()
+
 // Button matrix pins (3x3)
 #define ROW1_PIN 13
 #define ROW2_PIN 14
@@ -46,10 +100,6 @@ extern bool hasCustomerScanned;
 // extern bool hasUpcomingCustomerInQueue;
 extern bool readyToScan;
 extern bool exitWaitTimeout;
-extern bool confirmationMode;
-extern bool confirmationAccepted;
-extern bool uploadInProgress;
-extern bool deliveryPending;
 extern volatile int currentTicketID;
 extern unsigned long lastConnectivityCheck;
 extern unsigned long bakery_timeout_ms;
@@ -81,11 +131,10 @@ extern int bread1_cook_display;
 extern int bread2_cook_display;
 extern int bread3_cook_display;
 
-// Display mode for baker vs delivery
+// Display mode for baker vs delivery (owned by flow.cpp)
 #define DISPLAY_MODE_NONE     0
 #define DISPLAY_MODE_BAKER    1
 #define DISPLAY_MODE_DELIVERY 2
-extern int displayMode;
 
 // Bread limits
 #define MAX_BREAD_PER_TYPE 9
@@ -96,12 +145,25 @@ extern int max_total_breads;
 #define MQTT_RECONNECT_INTERVAL  3000
 #define DEADLOCK_TIMEOUT        30000
 #define BUSY_TIMEOUT             3000
-#define MQTT_QUEUE_TIMEOUT       2000
 #define HTTP_TIMEOUT            10000
 #define INIT_HTTP_TIMEOUT        7000
 #define INIT_RETRY_DELAY         5000
+#define INIT_DATA_VERSION        1      // bump when the cached init data layout changes
 #define HTTP_RETRY_DELAY         2000
 #define CONNECTIVITY_CHECK_INTERVAL 2000
+#define NETWORK_TASK_TICK_MS       10
+#define NET_COMMAND_QUEUE_DEPTH     4
+#define CONFIG_REFRESH_COALESCE_MS 1500
 #define TIME_FOR_RECEIVE_BREAD_MS 60000
+#define HTTP_SESSION_IDLE_TIMEOUT 50000   // below the server keep-alive timeout
+#define STATS_PUBLISH_INTERVAL   60000
+#define MQTT_FLUSH_WINDOW_MIN_MS   100    // adaptive batching window bounds
+#define MQTT_FLUSH_WINDOW_MAX_MS  1000
+#define MQTT_FLUSH_WINDOW_STEP_MS  100
+#define MQTT_PUBLISH_ATTEMPTS        3    // per message while connected; a disconnect keeps it queued
+#define ERROR_DEDUP_WINDOW_MS    60000    // repeats inside this window are only counted
+#define ERROR_DEDUP_SLOTS           16
+#define TICKET_PUSH_SILENCE_MS  120000   // push channel counts as live this long after a push
+#define TICKET_PUSH_FALLBACK_MS  30000   // HTTP safety-net poll while the push channel is live
 
 #endif
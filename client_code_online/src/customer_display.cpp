@@ -0,0 +1,277 @@
+#include "customer_display.h"
+#include "errors.h"
+#include "waitlist.h"
+#include <esp_now.h>
+
+#define LINK_NOTIFY_CALL       0x01
+#define LINK_NOTIFY_ACK        0x02
+#define LINK_NOTIFY_SEND_FAIL  0x04
+#define LINK_NOTIFY_WAIT_LIST  0x08
+
+static QueueHandle_t callQueue = NULL;
+static TaskHandle_t linkTaskHandle = NULL;
+static bool espNowReady = false;
+static bool peerReady = false;
+
+// Written by the ESP-NOW receive callback, read by customerDisplayTask
+static volatile uint16_t ackedSeq = 0;
+
+static portMUX_TYPE linkStatsMux = portMUX_INITIALIZER_UNLOCKED;
+static CustomerDisplayStats linkStats;
+static uint64_t linkAckSum = 0;
+
+// ---------- ESP-NOW CALLBACKS ----------
+// Both run on the WiFi task; they only hand over to customerDisplayTask
+static void onSendComplete(const uint8_t* mac, esp_now_send_status_t status) {
+  if (status != ESP_NOW_SEND_SUCCESS && linkTaskHandle) {
+    xTaskNotify(linkTaskHandle, LINK_NOTIFY_SEND_FAIL, eSetBits);
+  }
+}
+
+static void onReceive(const uint8_t* mac, const uint8_t* data, int len) {
+  if (memcmp(mac, displayEspNowMac, 6) != 0 || len < (int)sizeof(DisplayFrameHeader)) return;
+
+  DisplayFrameHeader h;
+  memcpy(&h, data, sizeof(h));
+  if (h.version != DISPLAY_FRAME_VERSION || h.type != DISPLAY_FRAME_ACK) return;
+
+  ackedSeq = h.seq;
+  if (linkTaskHandle) {
+    xTaskNotify(linkTaskHandle, LINK_NOTIFY_ACK, eSetBits);
+  }
+}
+
+static void addPeer() {
+  if (esp_now_is_peer_exist(displayEspNowMac)) {
+    esp_now_del_peer(displayEspNowMac);
+  }
+
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, displayEspNowMac, 6);
+  peer.channel = 0;
+  peer.encrypt = false;
+
+  peerReady = esp_now_add_peer(&peer) == ESP_OK;
+  if (!peerReady) {
+    Serial.println("Failed to add ESP-NOW peer");
+  }
+}
+
+// waitlist.cpp, on whichever task changed the mirror
+static void onWaitListChanged() {
+  if (linkTaskHandle) xTaskNotify(linkTaskHandle, LINK_NOTIFY_WAIT_LIST, eSetBits);
+}
+
+void initCustomerDisplay() {
+  callQueue = xQueueCreate(DISPLAY_LINK_QUEUE_DEPTH, sizeof(int));
+  waitListOnChange(onWaitListChanged);
+
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("ESP-NOW Init Failed!");
+    return;
+  }
+  esp_now_register_send_cb(onSendComplete);
+  esp_now_register_recv_cb(onReceive);
+  espNowReady = true;
+  addPeer();
+}
+
+bool customerDisplayCall(int ticketId) {
+  if (callQueue && xQueueSend(callQueue, &ticketId, (TickType_t)0) == pdTRUE) {
+    if (linkTaskHandle) xTaskNotify(linkTaskHandle, LINK_NOTIFY_CALL, eSetBits);
+    return true;
+  }
+  portENTER_CRITICAL(&linkStatsMux);
+  linkStats.calls_dropped++;
+  portEXIT_CRITICAL(&linkStatsMux);
+  reportError(ERR_TASK_ESPNOW_CALL_DROPPED, ticketId);
+  return false;
+}
+
+// ---------- LINK TASK ----------
+// Calls stay in pendingCalls (oldest first) until a frame carrying them is
+// acknowledged; calls queued while a frame is in flight go out in the next.
+// Until the display has answered a frame with an ACK (its firmware may not
+// speak ACKs) every frame is sent once and its calls count as delivered; a
+// display that stops answering drops the link back to that mode.
+static int pendingCalls[DISPLAY_LINK_MAX_CALLS];
+static int pendingCount = 0;
+static bool linkAcked = DISPLAY_LINK_ACKED;
+static bool waitListDirty = true;     // the display has not seen the current wait list
+
+static uint8_t frameBuf[sizeof(DisplayFrameHeader) + DISPLAY_FRAME_MAX_UPDATES * sizeof(DisplayTicketUpdate)];
+static size_t frameLen = 0;
+static uint16_t frameSeq = 0;
+static int frameCalls = 0;        // pendingCalls[0..frameCalls) are in the frame in flight
+static bool frameInFlight = false;
+static uint8_t frameAttempts = 0;
+static unsigned long frameSentAt = 0;
+static unsigned long retryAt = 0;
+static unsigned long backoffUntil = 0;
+
+static void addPendingCall(int ticketId) {
+  for (int i = 0; i < pendingCount; i++) {
+    if (pendingCalls[i] == ticketId) return;
+  }
+  if (pendingCount == DISPLAY_LINK_MAX_CALLS) {
+    // Full: the oldest call gives way
+    reportError(ERR_TASK_ESPNOW_CALL_DROPPED, pendingCalls[0]);
+    for (int i = 1; i < pendingCount; i++) pendingCalls[i - 1] = pendingCalls[i];
+    pendingCount--;
+    if (frameCalls > 0) frameCalls--;
+    portENTER_CRITICAL(&linkStatsMux);
+    linkStats.calls_dropped++;
+    portEXIT_CRITICAL(&linkStatsMux);
+  }
+  pendingCalls[pendingCount++] = ticketId;
+}
+
+static size_t appendUpdate(size_t n, DisplayUpdateKind kind, int ticketId) {
+  DisplayTicketUpdate u;
+  u.kind = kind;
+  u.ticket_id = ticketId;
+  memcpy(frameBuf + n, &u, sizeof(u));
+  return n + sizeof(u);
+}
+
+// All pending calls, then as much of the wait list as still fits
+static void buildFrame() {
+  DisplayFrameHeader h;
+  h.version = DISPLAY_FRAME_VERSION;
+  h.type = DISPLAY_FRAME_TICKETS;
+  h.seq = ++frameSeq;
+  h.count = 0;
+
+  size_t n = sizeof(h);
+  for (int i = 0; i < pendingCount; i++) {
+    n = appendUpdate(n, DISPLAY_UPDATE_CALL, pendingCalls[i]);
+    h.count++;
+  }
+  frameCalls = pendingCount;
+
+  int waiting[DISPLAY_FRAME_MAX_UPDATES];
+  int w = waitListSnapshot(waiting, DISPLAY_FRAME_MAX_UPDATES - h.count);
+  for (int i = 0; i < w; i++) {
+    n = appendUpdate(n, DISPLAY_UPDATE_WAITING, waiting[i]);
+    h.count++;
+  }
+
+  memcpy(frameBuf, &h, sizeof(h));
+  frameLen = n;
+  waitListDirty = false;
+}
+
+static void transmitFrame() {
+  esp_err_t result = peerReady ? esp_now_send(displayEspNowMac, frameBuf, frameLen) : ESP_FAIL;
+  if (result != ESP_OK) {
+    portENTER_CRITICAL(&linkStatsMux);
+    linkStats.send_fail++;
+    portEXIT_CRITICAL(&linkStatsMux);
+    reportError(ERR_TASK_ESPNOW_SEND, result);
+  }
+
+  unsigned long timeout = (unsigned long)DISPLAY_ACK_TIMEOUT_MS << frameAttempts;
+  if (timeout > DISPLAY_ACK_TIMEOUT_MAX_MS) timeout = DISPLAY_ACK_TIMEOUT_MAX_MS;
+  retryAt = millis() + timeout;
+  frameAttempts++;
+}
+
+static void dropFrameCalls() {
+  for (int i = frameCalls; i < pendingCount; i++) pendingCalls[i - frameCalls] = pendingCalls[i];
+  pendingCount -= frameCalls;
+  frameCalls = 0;
+  frameInFlight = false;
+}
+
+static void frameAcked() {
+  unsigned long rtt = millis() - frameSentAt;
+  dropFrameCalls();
+
+  portENTER_CRITICAL(&linkStatsMux);
+  linkStats.acks++;
+  linkAckSum += rtt;
+  if (rtt > linkStats.ack_max_ms) linkStats.ack_max_ms = rtt;
+  portEXIT_CRITICAL(&linkStatsMux);
+}
+
+void customerDisplayTask(void* param) {
+  linkTaskHandle = xTaskGetCurrentTaskHandle();
+
+  while (true) {
+    TickType_t wait = portMAX_DELAY;
+    unsigned long now = millis();
+    if (frameInFlight) {
+      long left = (long)(retryAt - now);
+      wait = left > 0 ? left / portTICK_PERIOD_MS : 0;
+    } else if (pendingCount > 0 || waitListDirty) {
+      long left = (long)(backoffUntil - now);
+      wait = left > 0 ? left / portTICK_PERIOD_MS : 0;
+    }
+
+    uint32_t bits = 0;
+    xTaskNotifyWait(0, 0xFFFFFFFF, &bits, wait);
+
+    int ticketId;
+    while (xQueueReceive(callQueue, &ticketId, (TickType_t)0) == pdTRUE) {
+      addPendingCall(ticketId);
+    }
+
+    if (bits & LINK_NOTIFY_WAIT_LIST) waitListDirty = true;
+    if ((bits & LINK_NOTIFY_ACK) && !linkAcked) {
+      Serial.println("Customer display ACKs frames: retransmitting until acknowledged");
+      linkAcked = true;
+    }
+    if (frameInFlight && (bits & LINK_NOTIFY_ACK) && ackedSeq == frameSeq) {
+      frameAcked();
+    }
+    if (bits & LINK_NOTIFY_SEND_FAIL) {
+      portENTER_CRITICAL(&linkStatsMux);
+      linkStats.send_fail++;
+      portEXIT_CRITICAL(&linkStatsMux);
+      reportError(ERR_TASK_ESPNOW_SEND, ESP_FAIL);
+    }
+
+    now = millis();
+    if (frameInFlight && (long)(now - retryAt) >= 0) {
+      if (frameAttempts > DISPLAY_LINK_MAX_RETRIES) {
+        // Display unreachable: rebuild the peer here, never in the caller,
+        // and keep the calls for the next attempt
+        reportError(ERR_TASK_ESPNOW_RETRY, frameSeq);
+        if (espNowReady) addPeer();
+        frameInFlight = false;
+        waitListDirty = true;
+        backoffUntil = now + DISPLAY_LINK_BACKOFF_MS;
+        // Perhaps the display was reflashed without ACKs: send once per frame
+        // again until it answers one
+        if (!DISPLAY_LINK_ACKED) linkAcked = false;
+      } else {
+        portENTER_CRITICAL(&linkStatsMux);
+        linkStats.retransmits++;
+        portEXIT_CRITICAL(&linkStatsMux);
+        transmitFrame();
+      }
+    }
+
+    if (!frameInFlight && (pendingCount > 0 || waitListDirty) && (long)(now - backoffUntil) >= 0) {
+      buildFrame();
+      frameAttempts = 0;
+      frameSentAt = now;
+      frameInFlight = true;
+      portENTER_CRITICAL(&linkStatsMux);
+      linkStats.frames++;
+      portEXIT_CRITICAL(&linkStatsMux);
+      transmitFrame();
+      if (!linkAcked) dropFrameCalls();
+    }
+  }
+}
+
+CustomerDisplayStats getCustomerDisplayStats() {
+  portENTER_CRITICAL(&linkStatsMux);
+  CustomerDisplayStats st = linkStats;
+  st.ack_avg_ms = st.acks ? (uint32_t)(linkAckSum / st.acks) : 0;
+  linkStats = CustomerDisplayStats();
+  linkAckSum = 0;
+  portEXIT_CRITICAL(&linkStatsMux);
+  return st;
+}
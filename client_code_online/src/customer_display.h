@@ -0,0 +1,19 @@
+#ifndef CUSTOMER_DISPLAY_H
+#define CUSTOMER_DISPLAY_H
+
+#include "config.h"
+#include "types.h"
+
+// ---------- CUSTOMER DISPLAY LINK ----------
+// customerDisplayTask owns ESP-NOW to the customer display: it frames the
+// calls with the current wait list whenever either changes, retransmits until
+// the display ACKs (once it has seen the display ACK at all, or always with
+// DISPLAY_LINK_ACKED), and re-adds the peer itself. Callers only queue and
+// return.
+void initCustomerDisplay();
+void customerDisplayTask(void* param);
+
+bool customerDisplayCall(int ticketId);
+CustomerDisplayStats getCustomerDisplayStats();
+
+#endif
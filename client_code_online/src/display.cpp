@@ -1,20 +1,54 @@
 #include "display.h"
+#include "flow.h"
+#include <atomic>
 
 // ---------- DISPLAY OBJECTS ----------
-LedControl lc(DIN_PIN, CLK_PIN, CS_PIN, 2);
+// Only displayRenderTask touches the chain once setup() is done
+static Max7219Chain lc(DIN_PIN, CLK_PIN, CS_PIN, DISPLAY_DEVICES);
 volatile DeviceStatus currentStatus = STATUS_NORMAL;
 int num1 = 0;
 int num2 = 0;
 int num3 = 0;
 
-void displayChar(char c) {
-  lc.clearDisplay(0);
-  lc.setChar(0, 0, c, false);
+static QueueHandle_t displayQueue = NULL;
+static volatile bool displayResync = false;
+static std::atomic<uint32_t> displayIntents(0);
+static uint32_t displayFrames = 0;
+
+void displayInit() {
+  displayQueue = xQueueCreate(DISPLAY_QUEUE_DEPTH, sizeof(DisplayCommand));
+
+  lc.begin();
+  for (int dev = 0; dev < DISPLAY_DEVICES; dev++) {
+    lc.shutdown(dev, false);
+    lc.setIntensity(dev, 15);
+    lc.clearDisplay(dev);
+  }
+  lc.flush();
 }
 
-void displayDash() {
-  lc.clearDisplay(0);
-  lc.setChar(0, 0, '-', false);
+DisplayStats getDisplayStats() {
+  DisplayStats st = lc.takeStats();
+  st.intents = displayIntents.exchange(0);
+  st.frames = displayFrames;
+  displayFrames = 0;
+  return st;
+}
+
+// Never blocks: a full queue just forces a full redraw on the next frame
+static void displayPost(DisplayIntent intent, int a = 0, int b = 0, int c = 0, char ch = 0) {
+  displayIntents.fetch_add(1, std::memory_order_relaxed);
+  if (!displayQueue) return;
+
+  DisplayCommand cmd;
+  cmd.intent = intent;
+  cmd.a = a;
+  cmd.b = b;
+  cmd.c = c;
+  cmd.ch = ch;
+  if (xQueueSend(displayQueue, &cmd, (TickType_t)0) != pdTRUE) {
+    displayResync = true;
+  }
 }
 
 // Base pattern: show G segment (dash) on specific digits for all states
@@ -102,8 +136,8 @@ static void showErrorCode(char codeChar) {
   lc.setChar(1, 3, codeChar, false);
 }
 
-void showNumbers(int a, int b, int c) {
-  if (currentStatus == STATUS_NORMAL && !confirmationMode) {
+static void drawNumbers(int a, int b, int c) {
+  if (currentStatus == STATUS_NORMAL && !flowIsConfirming()) {
     // Only update the main customer digits so we don't disturb cook display on 0,4
     lc.setDigit(0, 0, a % 10, false);
     lc.setDigit(0, 2, b % 10, false);
@@ -111,10 +145,10 @@ void showNumbers(int a, int b, int c) {
   }
 }
 
-void showOwnerBreadCounts() {
+static void drawOwnerBreadCounts() {
   int bakerTotal    = bread1_count_baker_display + bread2_count_baker_display + bread3_count_baker_display;
   // Only show baker display when in BAKER mode and there's something to show
-  if (displayMode != DISPLAY_MODE_BAKER || bakerTotal <= 0) {
+  if (flowDisplayMode() != DISPLAY_MODE_BAKER || bakerTotal <= 0) {
     lc.setRow(1, 6, 0);
     lc.setRow(1, 4, 0);
     lc.setRow(1, 3, 0);
@@ -127,15 +161,11 @@ void showOwnerBreadCounts() {
   lc.setDigit(1, 3, bread3_count_baker_display % 10, false);
 }
 
-void showBakerDisplay() {
-  showOwnerBreadCounts();
-}
-
-void showDeliveryDisplay() {
+static void drawDeliveryDisplay() {
   int deliveryTotal = bread1_delivery_display      + bread2_delivery_display      + bread3_delivery_display;
 
   // Only show delivery display when in DELIVERY mode and there's something to show
-  if (displayMode != DISPLAY_MODE_DELIVERY || deliveryTotal <= 0) {
+  if (flowDisplayMode() != DISPLAY_MODE_DELIVERY || deliveryTotal <= 0) {
     lc.setRow(1, 0, 0);
     lc.setRow(1, 5, 0);
     lc.setRow(1, 1, 0);
@@ -148,7 +178,7 @@ void showDeliveryDisplay() {
   lc.setDigit(1, 1, bread3_delivery_display % 10, false);
 }
 
-void showCookDisplay() {
+static void drawCookDisplay() {
   // Show cook-display counts: 1,2 / 1,7 / 0,4
   if (bread1_cook_display <= 0 && bread2_cook_display <= 0 && bread3_cook_display <= 0) {
     // Nothing to show on cook display: turn digits off
@@ -165,16 +195,55 @@ void showCookDisplay() {
   }
 }
 
-void setStatus(DeviceStatus st) {
-  currentStatus = st;
-  Serial.println("New Status: " + String(st));
+// ---------- CONFIRM ANIMATION ----------
+// One segment at a time on the customer digits (and on the baker digits
+// while an order upload is in flight)
+static const uint8_t confirmSegmentMasks[6] = {
+  0b01000000, // A
+  0b00100000, // B
+  0b00010000, // C
+  0b00001000, // D
+  0b00000100, // E
+  0b00000010  // F
+};
+
+static bool confirmAnimationActive() {
+  return (flowIsConfirming() || flowIsUploading()) && currentStatus == STATUS_NORMAL;
+}
+
+static void drawConfirmAnimation(int step) {
+  uint8_t mask = confirmSegmentMasks[step];
+
+  // Customer-facing digits 0,2,3 on device 0 animate while confirming;
+  // during an upload alone they already take the next customer's counts
+  if (flowIsConfirming()) {
+    lc.setRow(0, 0, mask);
+    lc.setRow(0, 2, mask);
+    lc.setRow(0, 3, mask);
+  }
+
+  // Only touch baker-side digits when baker display is the active mode
+  if (flowDisplayMode() == DISPLAY_MODE_BAKER) {
+    if (flowIsUploading() && !flowIsConfirming()) {
+      lc.setRow(1, 6, mask);
+      lc.setRow(1, 4, mask);
+      lc.setRow(1, 3, mask);
+    } else {
+      // Before accept, keep baker display showing static counts
+      drawOwnerBreadCounts();
+    }
+  }
+}
+
+static void drawStatus() {
+  DeviceStatus st = currentStatus;
   lc.clearDisplay(0);
 
   if (st == STATUS_NORMAL) {
-    showNumbers(num1, num2, num3);
-    showBakerDisplay();
-    showDeliveryDisplay();
-    showCookDisplay();
+    drawNumbers(num1, num2, num3);
+    drawOwnerBreadCounts();
+    drawDeliveryDisplay();
+    drawCookDisplay();
   }
   else if (st == STATUS_WIFI_CONNECTING) {
     showWifiConnectingPattern();
@@ -195,3 +264,125 @@ void setStatus(DeviceStatus st) {
     showInitPattern();
   }
 }
+
+// ---------- RENDER TASK ----------
+// Owns the MAX7219 chain. Intents that arrive within one DISPLAY_FRAME_MS
+// frame are folded into a bitmask (a later intent of the same kind replaces
+// an earlier one, a status redraw covers all partial ones), drawn into the
+// shadow framebuffer, and flushed once. Callers never wait on display I/O.
+#define DIRTY(intent) (1u << (intent))
+
+void displayRenderTask(void* param) {
+  uint32_t pending = DIRTY(DISPLAY_INTENT_STATUS);
+  int numA = 0, numB = 0, numC = 0;
+  char ch = 0;
+  bool animating = false;
+  int animStep = 0;
+  TickType_t nextAnimStep = 0;
+  DisplayCommand cmd;
+
+  while (true) {
+    TickType_t wait = portMAX_DELAY;
+    if (animating) {
+      TickType_t now = xTaskGetTickCount();
+      wait = (int32_t)(nextAnimStep - now) > 0 ? nextAnimStep - now : 0;
+    }
+
+    if (pending == 0 && xQueueReceive(displayQueue, &cmd, wait) == pdTRUE) {
+      // Let the rest of this frame's intents land, then take them all
+      vTaskDelay(DISPLAY_FRAME_MS / portTICK_PERIOD_MS);
+      do {
+        pending |= DIRTY(cmd.intent);
+        if (cmd.intent == DISPLAY_INTENT_NUMBERS) {
+          numA = cmd.a;
+          numB = cmd.b;
+          numC = cmd.c;
+        } else if (cmd.intent == DISPLAY_INTENT_CHAR) {
+          ch = cmd.ch;
+        }
+      } while (xQueueReceive(displayQueue, &cmd, 0) == pdTRUE);
+    }
+
+    if (displayResync) {
+      displayResync = false;
+      pending |= DIRTY(DISPLAY_INTENT_STATUS);
+    }
+
+    // Leaving confirm mode: put back whatever the animation drew over
+    bool animateNow = confirmAnimationActive();
+    if (animating && !animateNow) pending |= DIRTY(DISPLAY_INTENT_STATUS);
+    if (!animating && animateNow) {
+      animStep = -1;  // first step below shows segment A
+      nextAnimStep = xTaskGetTickCount();
+    }
+    animating = animateNow;
+
+    if (pending & DIRTY(DISPLAY_INTENT_STATUS)) {
+      drawStatus();
+      // A numbers intent folded into the same frame is newer than num1..3
+      if (pending & DIRTY(DISPLAY_INTENT_NUMBERS)) drawNumbers(numA, numB, numC);
+    } else {
+      if (pending & DIRTY(DISPLAY_INTENT_NUMBERS)) drawNumbers(numA, numB, numC);
+      if (pending & DIRTY(DISPLAY_INTENT_OWNER_COUNTS)) drawOwnerBreadCounts();
+      if (pending & DIRTY(DISPLAY_INTENT_DELIVERY)) drawDeliveryDisplay();
+      if (pending & DIRTY(DISPLAY_INTENT_COOK)) drawCookDisplay();
+    }
+    if (pending & DIRTY(DISPLAY_INTENT_CHAR)) {
+      lc.clearDisplay(0);
+      lc.setChar(0, 0, ch, false);
+    }
+    pending = 0;
+
+    if (animating) {
+      // Redraw the current step every frame so a status redraw can't blank
+      // the animated digits; only advance it on its own clock
+      if ((int32_t)(xTaskGetTickCount() - nextAnimStep) >= 0) {
+        animStep = (animStep + 1) % 6;
+        nextAnimStep = xTaskGetTickCount() + CONFIRM_ANIM_STEP_MS / portTICK_PERIOD_MS;
+      }
+      drawConfirmAnimation(animStep);
+    }
+
+    lc.flush();
+    displayFrames++;
+  }
+}
+
+// ---------- DISPLAY FUNCTIONS ----------
+void displayChar(char c) {
+  displayPost(DISPLAY_INTENT_CHAR, 0, 0, 0, c);
+}
+
+void displayDash() {
+  displayPost(DISPLAY_INTENT_CHAR, 0, 0, 0, '-');
+}
+
+void showNumbers(int a, int b, int c) {
+  displayPost(DISPLAY_INTENT_NUMBERS, a, b, c);
+}
+
+void showOwnerBreadCounts() {
+  displayPost(DISPLAY_INTENT_OWNER_COUNTS);
+}
+
+void showBakerDisplay() {
+  showOwnerBreadCounts();
+}
+
+void showDeliveryDisplay() {
+  displayPost(DISPLAY_INTENT_DELIVERY);
+}
+
+void showCookDisplay() {
+  displayPost(DISPLAY_INTENT_COOK);
+}
+
+void showConfirmAnimation() {
+  displayPost(DISPLAY_INTENT_CONFIRM_ANIM);
+}
+
+void setStatus(DeviceStatus st) {
+  currentStatus = st;
+  Serial.println("New Status: " + String(st));
+  displayPost(DISPLAY_INTENT_STATUS);
+}
@@ -1,16 +1,18 @@
 #ifndef DISPLAY_H
 #define DISPLAY_H
 
-#include <LedControl.h>
 #include "config.h"
 #include "types.h"
+#include "max7219.h"
 
 // ---------- DISPLAY OBJECTS ----------
-extern LedControl lc;
 extern volatile DeviceStatus currentStatus;
 extern int num1, num2, num3;
 
 // ---------- DISPLAY FUNCTIONS ----------
+// All of these only queue an intent for displayRenderTask
+void displayInit();
+DisplayStats getDisplayStats();
 void displayChar(char c);
 void displayDash();
 void showNumbers(int a, int b, int c);
@@ -19,5 +21,9 @@ void showOwnerBreadCounts();
 void showBakerDisplay();
 void showDeliveryDisplay();
 void showCookDisplay();
+void showConfirmAnimation();
+
+// ---------- DISPLAY TASK ----------
+void displayRenderTask(void* param);
 
 #endif
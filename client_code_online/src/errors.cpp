@@ -0,0 +1,100 @@
+#include "errors.h"
+#include "mqtt.h"
+
+// ---------- ERROR AGGREGATION ----------
+struct ErrorRecord {
+  bool used;
+  uint16_t code;
+  int32_t detail;
+  uint32_t count;
+  unsigned long first_ms;
+  unsigned long last_ms;
+};
+
+static ErrorRecord errorRecords[ERROR_DEDUP_SLOTS];
+static portMUX_TYPE errorMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t suppressedErrors = 0;
+
+static void publishErrorRecord(const ErrorRecord& rec) {
+  char payload[48];
+  int len = snprintf(payload, sizeof(payload), "%u,%ld,%lu,%lu,%lu",
+                     (unsigned)rec.code, (long)rec.detail, (unsigned long)rec.count,
+                     rec.first_ms / 1000, rec.last_ms / 1000);
+  queueMqttMessage(MQTT_TOPIC_ERROR, payload, len, true);
+}
+
+void reportError(ErrorCode code, int32_t detail) {
+  unsigned long now = millis();
+  bool isNew = false;
+  bool evicted = false;
+  ErrorRecord rec;
+  ErrorRecord old;
+
+  portENTER_CRITICAL(&errorMux);
+  int freeSlot = -1;
+  int oldest = 0;
+  int found = -1;
+  for (int i = 0; i < ERROR_DEDUP_SLOTS; i++) {
+    if (!errorRecords[i].used) {
+      if (freeSlot < 0) freeSlot = i;
+      continue;
+    }
+    if (errorRecords[i].code == code && errorRecords[i].detail == detail) {
+      found = i;
+      break;
+    }
+    if (errorRecords[i].first_ms < errorRecords[oldest].first_ms || !errorRecords[oldest].used) oldest = i;
+  }
+
+  if (found >= 0) {
+    errorRecords[found].count++;
+    errorRecords[found].last_ms = now;
+    suppressedErrors++;
+  } else {
+    // Table full: the oldest record makes room, closing its window early
+    int slot = freeSlot >= 0 ? freeSlot : oldest;
+    if (freeSlot < 0) {
+      old = errorRecords[slot];
+      evicted = true;
+    }
+    errorRecords[slot] = { true, (uint16_t)code, detail, 1, now, now };
+    rec = errorRecords[slot];
+    isNew = true;
+  }
+  portEXIT_CRITICAL(&errorMux);
+
+  // Same rule as errorsTick(): a summary only if repeats were suppressed
+  if (evicted && old.count > 1) {
+    publishErrorRecord(old);
+  }
+
+  if (isNew) {
+    Serial.printf("error %u detail=%ld\n", (unsigned)code, (long)detail);
+    publishErrorRecord(rec);
+  }
+}
+
+void errorsTick() {
+  unsigned long now = millis();
+  for (int i = 0; i < ERROR_DEDUP_SLOTS; i++) {
+    bool expired = false;
+    ErrorRecord rec;
+
+    portENTER_CRITICAL(&errorMux);
+    if (errorRecords[i].used && now - errorRecords[i].first_ms >= ERROR_DEDUP_WINDOW_MS) {
+      rec = errorRecords[i];
+      errorRecords[i].used = false;
+      expired = true;
+    }
+    portEXIT_CRITICAL(&errorMux);
+
+    // The first occurrence already went out; only report suppressed repeats
+    if (expired && rec.count > 1) {
+      publishErrorRecord(rec);
+    }
+  }
+}
+
+uint32_t getSuppressedErrorCount() {
+  return suppressedErrors;
+}
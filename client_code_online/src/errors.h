@@ -0,0 +1,68 @@
+#ifndef ERRORS_H
+#define ERRORS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ---------- ERROR CODES ----------
+// Stable numeric ids for every error call site. Values are part of the wire
+// format on bakery/{id}/error: never renumber, only append.
+enum ErrorCode : uint16_t {
+  // api.cpp
+  ERR_API_INIT_HTTP            = 100,
+  ERR_API_INIT_JSON            = 101,
+  ERR_API_INIT_BAD_ENTRY       = 102,
+  ERR_API_NEW_CUSTOMER_HTTP    = 110,
+  ERR_API_NEW_CUSTOMER_JSON    = 111,
+  ERR_API_NEW_CUSTOMER_NO_ID   = 112,
+  ERR_API_NEW_BREAD_HTTP       = 120,
+  ERR_API_NEW_BREAD_JSON       = 121,
+  ERR_API_COOK_DISPLAY_HTTP    = 130,
+  ERR_API_COOK_DISPLAY_JSON    = 131,
+  ERR_API_COOK_DISPLAY_NO_DATA = 132,
+  ERR_API_SERVE_TICKET_HTTP    = 140,
+  ERR_API_SERVE_TICKET_JSON    = 141,
+  ERR_API_CURRENT_TICKET_HTTP  = 150,
+  ERR_API_CURRENT_TICKET_JSON  = 151,
+  ERR_API_WAIT_LIST_HTTP       = 160,
+  ERR_API_QUEUE_FULL           = 170,
+
+  // network.cpp
+  ERR_NET_NO_HTTP_SESSION      = 200,
+  ERR_NET_HTTP_RETRIES         = 201,
+
+  // tasks.cpp
+  ERR_TASK_INIT_RETRY          = 300,
+  ERR_TASK_NEW_CUSTOMER        = 301,
+  ERR_TASK_ORDER_SUBMIT        = 302,
+  ERR_TASK_SERVE_TICKET        = 303,
+  ERR_TASK_WAIT_LIST           = 304,
+  ERR_TASK_ESPNOW_SEND         = 305,
+  ERR_TASK_ESPNOW_RETRY        = 306,
+  ERR_TASK_ESPNOW_CALL_DROPPED = 307,
+  ERR_TASK_ORDER_OFFLINE       = 308,
+
+  // mqtt.cpp
+  ERR_MQTT_INIT_NOT_READY      = 400,
+  ERR_MQTT_INIT_BUSY           = 401,
+  ERR_MQTT_INIT_FETCH          = 402,
+
+  // mutex.cpp
+  ERR_SYS_DEADLOCK             = 500,
+
+  // printer.cpp
+  ERR_PRINTER_FINISH_DROPPED   = 600
+};
+
+// ---------- ERROR AGGREGATION ----------
+// The first occurrence of a (code, detail) pair is published at once.
+// Repeats within ERROR_DEDUP_WINDOW_MS are only counted; when the window
+// closes one summary record is published if anything was suppressed.
+//
+// Record format (CSV): <code>,<detail>,<count>,<first_s>,<last_s>
+// where first_s/last_s are seconds since boot.
+void reportError(ErrorCode code, int32_t detail = 0);
+void errorsTick();
+uint32_t getSuppressedErrorCount();
+
+#endif
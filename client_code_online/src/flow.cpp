@@ -0,0 +1,223 @@
+#include "flow.h"
+#include "display.h"
+#include <atomic>
+
+// ---------- ORDER / DELIVERY FLOW ----------
+// The keypad, the order worker and the ticket flow all drive the same state.
+// Every change goes through flowDispatch(): the matching row of flowTable is
+// applied under flowMux together with its bread count side effects, so the
+// tasks never see a half-applied transition. Reads are a single atomic load.
+
+#define FLOW_STATE_BITS    0x0F
+#define FLOW_DISPLAY_SHIFT 4
+#define FLOW_ANY_DISPLAY   0xFF
+
+// Side effects on the bread count globals
+#define FLOW_ACT_COPY_BAKER      0x01  // keypad counts -> baker digits
+#define FLOW_ACT_CLEAR_BAKER     0x02
+#define FLOW_ACT_CLEAR_DELIVERY  0x04
+
+// Bit set in flowEvents while no delivery is pending (scannerTask waits on it)
+#define FLOW_BIT_NO_DELIVERY     BIT0
+
+enum FlowDisplayRule : uint8_t {
+  FLOW_DISPLAY_KEEP,
+  FLOW_DISPLAY_BAKER_IF_NONE,     // take the digits if nothing else is shown
+  FLOW_DISPLAY_DELIVERY_IF_NONE,
+  FLOW_DISPLAY_DELIVERY_OR_NONE,  // show a pending delivery, otherwise clear
+  FLOW_DISPLAY_BAKER_OR_NONE      // show a held baker order, otherwise clear
+};
+
+struct FlowTransition {
+  FlowEvent event;
+  uint8_t whenMask;     // state bits that must equal whenBits
+  uint8_t whenBits;
+  uint8_t whenDisplay;  // DISPLAY_MODE_* or FLOW_ANY_DISPLAY
+  uint8_t set;
+  uint8_t clear;
+  uint8_t actions;
+  FlowDisplayRule display;
+};
+
+// First matching row wins; an event without a matching row is rejected and
+// leaves everything untouched
+static const FlowTransition flowTable[] = {
+  // event                  when mask                         when bits        when display           set              clear            actions                  display
+  { FLOW_EV_CONFIRM,        FLOW_CONFIRMING,                  0,               FLOW_ANY_DISPLAY,      FLOW_CONFIRMING, 0,               FLOW_ACT_COPY_BAKER,     FLOW_DISPLAY_BAKER_IF_NONE },
+  { FLOW_EV_ACCEPT,         FLOW_CONFIRMING,                  FLOW_CONFIRMING, FLOW_ANY_DISPLAY,      FLOW_UPLOADING,  FLOW_CONFIRMING, 0,                       FLOW_DISPLAY_KEEP },
+  { FLOW_EV_REJECT,         FLOW_CONFIRMING,                  FLOW_CONFIRMING, FLOW_ANY_DISPLAY,      0,               FLOW_CONFIRMING, FLOW_ACT_CLEAR_BAKER,    FLOW_DISPLAY_DELIVERY_OR_NONE },
+  // Baker digits held the last accepted order; keep them if the next one is already being confirmed
+  { FLOW_EV_ORDERS_DRAINED, FLOW_CONFIRMING | FLOW_UPLOADING, FLOW_UPLOADING,  FLOW_ANY_DISPLAY,      0,               FLOW_UPLOADING,  FLOW_ACT_CLEAR_BAKER,    FLOW_DISPLAY_DELIVERY_OR_NONE },
+  { FLOW_EV_ORDERS_DRAINED, FLOW_UPLOADING,                   FLOW_UPLOADING,  FLOW_ANY_DISPLAY,      0,               FLOW_UPLOADING,  0,                       FLOW_DISPLAY_KEEP },
+  { FLOW_EV_DELIVERY,       FLOW_DELIVERY,                    0,               FLOW_ANY_DISPLAY,      FLOW_DELIVERY,   0,               0,                       FLOW_DISPLAY_DELIVERY_IF_NONE },
+  // Delivery is accepted only while it is actually shown
+  { FLOW_EV_DELIVERY_DONE,  FLOW_DELIVERY,                    FLOW_DELIVERY,   DISPLAY_MODE_DELIVERY, 0,               FLOW_DELIVERY,   FLOW_ACT_CLEAR_DELIVERY, FLOW_DISPLAY_BAKER_OR_NONE },
+  { FLOW_EV_DELIVERY_CANCEL, FLOW_DELIVERY,                   FLOW_DELIVERY,   FLOW_ANY_DISPLAY,      0,               FLOW_DELIVERY,   FLOW_ACT_CLEAR_DELIVERY, FLOW_DISPLAY_BAKER_OR_NONE },
+};
+
+static const char* const flowEventNames[] = {
+  "CONFIRM", "ACCEPT", "REJECT", "ORDERS_DRAINED", "DELIVERY", "DELIVERY_DONE", "DELIVERY_CANCEL"
+};
+
+static portMUX_TYPE flowMux = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<uint8_t> flowState(DISPLAY_MODE_NONE << FLOW_DISPLAY_SHIFT);
+static EventGroupHandle_t flowEvents = NULL;
+static uint32_t flowRejected = 0;
+static std::atomic<uint32_t> flowVersion(0);   // accepted transitions
+
+static FlowLogEntry flowLog[FLOW_LOG_SIZE];
+static uint32_t flowLogCount = 0;   // total entries written; ring index = count % size
+
+void initFlow() {
+  flowEvents = xEventGroupCreate();
+  xEventGroupSetBits(flowEvents, FLOW_BIT_NO_DELIVERY);
+}
+
+static const FlowTransition* findTransition(FlowEvent ev, uint8_t state) {
+  uint8_t bits = state & FLOW_STATE_BITS;
+  uint8_t display = state >> FLOW_DISPLAY_SHIFT;
+  for (size_t i = 0; i < sizeof(flowTable) / sizeof(flowTable[0]); i++) {
+    const FlowTransition& t = flowTable[i];
+    if (t.event != ev) continue;
+    if ((bits & t.whenMask) != t.whenBits) continue;
+    if (t.whenDisplay != FLOW_ANY_DISPLAY && t.whenDisplay != display) continue;
+    return &t;
+  }
+  return NULL;
+}
+
+static uint8_t resolveDisplay(FlowDisplayRule rule, uint8_t bits, uint8_t display) {
+  int bakerTotal = bread1_count_baker_display + bread2_count_baker_display + bread3_count_baker_display;
+  int deliveryTotal = bread1_delivery_display + bread2_delivery_display + bread3_delivery_display;
+
+  switch (rule) {
+    case FLOW_DISPLAY_BAKER_IF_NONE:
+      return display == DISPLAY_MODE_NONE ? DISPLAY_MODE_BAKER : display;
+    case FLOW_DISPLAY_DELIVERY_IF_NONE:
+      return display == DISPLAY_MODE_NONE ? DISPLAY_MODE_DELIVERY : display;
+    case FLOW_DISPLAY_DELIVERY_OR_NONE:
+      return ((bits & FLOW_DELIVERY) && deliveryTotal > 0) ? DISPLAY_MODE_DELIVERY : DISPLAY_MODE_NONE;
+    case FLOW_DISPLAY_BAKER_OR_NONE:
+      return bakerTotal > 0 ? DISPLAY_MODE_BAKER : DISPLAY_MODE_NONE;
+    default:
+      return display;
+  }
+}
+
+// The event group cannot be written inside the critical section, so a task
+// that got preempted after leaving it could publish a stale bit over a newer
+// transition. Derive the bit from the current state instead, and again if a
+// transition landed while writing it: the last write always matches.
+static void syncDeliveryBit() {
+  if (!flowEvents) return;
+  uint32_t version;
+  do {
+    version = flowVersion.load();
+    if (flowState.load() & FLOW_DELIVERY) {
+      xEventGroupClearBits(flowEvents, FLOW_BIT_NO_DELIVERY);
+    } else {
+      xEventGroupSetBits(flowEvents, FLOW_BIT_NO_DELIVERY);
+    }
+  } while (flowVersion.load() != version);
+}
+
+bool flowDispatch(FlowEvent ev) {
+  portENTER_CRITICAL(&flowMux);
+  uint8_t from = flowState.load();
+  uint8_t to = from;
+  const FlowTransition* t = findTransition(ev, from);
+
+  if (t) {
+    if (t->actions & FLOW_ACT_COPY_BAKER) {
+      bread1_count_baker_display = bread1_count;
+      bread2_count_baker_display = bread2_count;
+      bread3_count_baker_display = bread3_count;
+    }
+    if (t->actions & FLOW_ACT_CLEAR_BAKER) {
+      bread1_count_baker_display = 0;
+      bread2_count_baker_display = 0;
+      bread3_count_baker_display = 0;
+    }
+    if (t->actions & FLOW_ACT_CLEAR_DELIVERY) {
+      bread1_delivery_display = 0;
+      bread2_delivery_display = 0;
+      bread3_delivery_display = 0;
+    }
+
+    uint8_t bits = ((from & FLOW_STATE_BITS) | t->set) & ~t->clear;
+    uint8_t display = resolveDisplay(t->display, bits, from >> FLOW_DISPLAY_SHIFT);
+    to = bits | (display << FLOW_DISPLAY_SHIFT);
+    flowState.store(to);
+    flowVersion++;
+  } else {
+    flowRejected++;
+  }
+
+  FlowLogEntry& e = flowLog[flowLogCount % FLOW_LOG_SIZE];
+  e.ms = millis();
+  e.event = ev;
+  e.from = from;
+  e.to = to;
+  e.accepted = (t != NULL);
+  flowLogCount++;
+  portEXIT_CRITICAL(&flowMux);
+
+  if (!t) return false;
+
+  syncDeliveryBit();
+
+  // Every region the flow decides redraws from the new state (or blanks)
+  showOwnerBreadCounts();
+  showDeliveryDisplay();
+  showConfirmAnimation();
+  return true;
+}
+
+bool flowIsConfirming() {
+  return flowState.load() & FLOW_CONFIRMING;
+}
+
+bool flowIsUploading() {
+  return flowState.load() & FLOW_UPLOADING;
+}
+
+bool flowDeliveryPending() {
+  return flowState.load() & FLOW_DELIVERY;
+}
+
+int flowDisplayMode() {
+  return flowState.load() >> FLOW_DISPLAY_SHIFT;
+}
+
+uint8_t flowGetState() {
+  return flowState.load();
+}
+
+bool flowWaitNoDelivery(TickType_t wait) {
+  if (!flowEvents) return !flowDeliveryPending();
+  EventBits_t bits = xEventGroupWaitBits(flowEvents, FLOW_BIT_NO_DELIVERY, pdFALSE, pdTRUE, wait);
+  return (bits & FLOW_BIT_NO_DELIVERY) != 0;
+}
+
+uint32_t getFlowRejectedCount() {
+  return flowRejected;
+}
+
+// Oldest first
+void flowPrintLog() {
+  FlowLogEntry copy[FLOW_LOG_SIZE];
+  uint32_t count;
+
+  portENTER_CRITICAL(&flowMux);
+  count = flowLogCount;
+  memcpy(copy, flowLog, sizeof(copy));
+  portEXIT_CRITICAL(&flowMux);
+
+  uint32_t n = count < FLOW_LOG_SIZE ? count : FLOW_LOG_SIZE;
+  for (uint32_t i = count - n; i < count; i++) {
+    const FlowLogEntry& e = copy[i % FLOW_LOG_SIZE];
+    Serial.printf("flow %lu %s 0x%02x -> 0x%02x%s\n",
+                  (unsigned long)e.ms, flowEventNames[e.event],
+                  e.from, e.to, e.accepted ? "" : " (rejected)");
+  }
+}
@@ -0,0 +1,24 @@
+#ifndef FLOW_H
+#define FLOW_H
+
+#include "config.h"
+#include "types.h"
+
+// ---------- ORDER / DELIVERY FLOW ----------
+// Confirmation, upload and delivery state, changed only through flowDispatch()
+void initFlow();
+bool flowDispatch(FlowEvent ev);   // false when the event is not valid in the current state
+
+bool flowIsConfirming();
+bool flowIsUploading();
+bool flowDeliveryPending();
+int flowDisplayMode();
+uint8_t flowGetState();            // state bits | display mode << 4
+
+// Blocks until no delivery is pending; false on timeout
+bool flowWaitNoDelivery(TickType_t wait);
+
+uint32_t getFlowRejectedCount();
+void flowPrintLog();
+
+#endif
@@ -0,0 +1,66 @@
+#include "http_stream.h"
+
+HttpBodyStream::HttpBodyStream(Stream& src, int contentLength, bool chunked)
+  : src(src), remaining(chunked ? 0 : contentLength), chunked(chunked) {}
+
+int HttpBodyStream::available() {
+  if (done) return 0;
+  return src.available();
+}
+
+// True while body bytes are left, moving on to the next chunk if needed
+bool HttpBodyStream::ready() {
+  if (done) return false;
+  if (remaining == 0 && !(chunked && nextChunk())) {
+    done = true;
+    return false;
+  }
+  return true;
+}
+
+int HttpBodyStream::read() {
+  if (!ready()) return -1;
+  uint8_t c;
+  if (src.readBytes(&c, 1) != 1) {
+    done = true;
+    return -1;
+  }
+  if (remaining > 0) remaining--;
+  return c;
+}
+
+int HttpBodyStream::peek() {
+  return ready() ? src.peek() : -1;
+}
+
+void HttpBodyStream::drain() {
+  while (read() >= 0) {}
+}
+
+// Reads one CRLF-terminated line into buf, returns false on timeout
+bool HttpBodyStream::readLine(char* buf, size_t len) {
+  size_t n = 0;
+  char c;
+  while (src.readBytes(&c, 1) == 1) {
+    if (c == '\n') {
+      buf[n] = '\0';
+      return true;
+    }
+    if (c != '\r' && n + 1 < len) buf[n++] = c;
+  }
+  return false;
+}
+
+bool HttpBodyStream::nextChunk() {
+  char line[16];
+  if (seenChunk && !readLine(line, sizeof(line))) return false;  // CRLF after previous data
+  seenChunk = true;
+  if (!readLine(line, sizeof(line))) return false;
+  long size = strtol(line, NULL, 16);
+  if (size <= 0) {
+    readLine(line, sizeof(line));  // CRLF closing the last chunk
+    return false;
+  }
+  remaining = size;
+  return true;
+}
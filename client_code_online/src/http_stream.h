@@ -0,0 +1,35 @@
+#ifndef HTTP_STREAM_H
+#define HTTP_STREAM_H
+
+#include <Arduino.h>
+
+// ---------- STREAMED RESPONSE BODY ----------
+// Presents exactly the response body of the current request as a Stream,
+// decoding chunked transfer encoding, so ArduinoJson can parse straight off
+// the socket. drain() consumes what the parser left so the socket stays
+// usable for the next keep-alive request.
+class HttpBodyStream : public Stream {
+ public:
+  // contentLength -1: no length given, the body runs until the server closes
+  HttpBodyStream(Stream& src, int contentLength, bool chunked);
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t) override { return 0; }
+
+  void drain();
+
+ private:
+  bool readLine(char* buf, size_t len);
+  bool nextChunk();
+  bool ready();
+
+  Stream& src;
+  long remaining;  // -1 when the server gave no length and closes the socket
+  bool chunked;
+  bool seenChunk = false;
+  bool done = false;
+};
+
+#endif
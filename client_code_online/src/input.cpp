@@ -0,0 +1,231 @@
+#include "input.h"
+#include <esp_timer.h>
+#include <soc/gpio_reg.h>
+
+static const int rowPins[3] = { ROW1_PIN, ROW2_PIN, ROW3_PIN };
+static const int colPins[3] = { COL1_PIN, COL2_PIN, COL3_PIN };
+
+// Rows are driven through GPIO_OUT_W1TS/W1TC, which only cover GPIO 0..31
+static_assert(ROW1_PIN < 32 && ROW2_PIN < 32 && ROW3_PIN < 32, "keypad rows must be GPIO 0..31");
+#define ROW_BIT(pin) (1UL << (pin))
+static const uint32_t rowBits[3] = { ROW_BIT(ROW1_PIN), ROW_BIT(ROW2_PIN), ROW_BIT(ROW3_PIN) };
+static const uint32_t allRowBits = ROW_BIT(ROW1_PIN) | ROW_BIT(ROW2_PIN) | ROW_BIT(ROW3_PIN);
+
+// +/- keys (matrix columns 0 and 1) auto-repeat while held on their own
+static const uint16_t repeatKeys =
+  (1u << INPUT_KEY_MATRIX(0, 0)) | (1u << INPUT_KEY_MATRIX(0, 1)) |
+  (1u << INPUT_KEY_MATRIX(1, 0)) | (1u << INPUT_KEY_MATRIX(1, 1)) |
+  (1u << INPUT_KEY_MATRIX(2, 0)) | (1u << INPUT_KEY_MATRIX(2, 1));
+
+static QueueHandle_t inputEventQueue = NULL;
+static TaskHandle_t inputTaskHandle = NULL;
+
+// First edge not yet accounted to an event, 0 = none
+static volatile uint32_t inputEdgeUs = 0;
+// Set while inputTask drives the rows, so the column edges it causes are
+// not mistaken for key activity
+static volatile bool inputScanning = false;
+
+static uint32_t inputEvents = 0;
+static uint32_t inputWakeups = 0;
+static uint64_t inputLatencySum = 0;
+static uint32_t inputLatencyMax = 0;
+static uint64_t inputScanCyclesSum = 0;
+static uint32_t inputScanCyclesMax = 0;
+
+// ---------- INTERRUPTS ----------
+static void IRAM_ATTR wakeInputTask() {
+  if (inputEdgeUs == 0) inputEdgeUs = (uint32_t)esp_timer_get_time() | 1;
+
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(inputTaskHandle, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+static void IRAM_ATTR matrixIsr() {
+  if (!inputScanning) wakeInputTask();
+}
+
+static void IRAM_ATTR buttonIsr() {
+  wakeInputTask();
+}
+
+// Attached from inputTask, once the task handle they notify exists
+static void attachInputInterrupts() {
+  for (int i = 0; i < 3; i++) {
+    attachInterrupt(digitalPinToInterrupt(colPins[i]), matrixIsr, CHANGE);
+  }
+  attachInterrupt(digitalPinToInterrupt(CONFIRM_BUTTON_PIN), buttonIsr, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(NEW_BREAD_BUTTON_PIN), buttonIsr, CHANGE);
+}
+
+// ---------- SCAN KERNEL ----------
+// All 40 input levels: GPIO 0..31 from GPIO_IN, 32..39 from GPIO_IN1
+static inline uint64_t readGpioLevels() {
+  return ((uint64_t)REG_READ(GPIO_IN1_REG) << 32) | REG_READ(GPIO_IN_REG);
+}
+
+static inline bool pinLow(uint64_t levels, int pin) {
+  return !((levels >> pin) & 1);
+}
+
+// Idle: every row is driven LOW, so any pressed key pulls its column LOW
+// and raises an edge.
+static inline void idleRows() {
+  REG_WRITE(GPIO_OUT_W1TC_REG, allRowBits);
+}
+
+// One bit per INPUT_KEY_*, 1 = pressed. Each row costs two register writes
+// and one snapshot of the input registers; the columns are picked out of it.
+static uint16_t readKeys() {
+  uint16_t keys = 0;
+
+  inputScanning = true;
+  for (int row = 0; row < 3; row++) {
+    REG_WRITE(GPIO_OUT_W1TS_REG, allRowBits & ~rowBits[row]);
+    REG_WRITE(GPIO_OUT_W1TC_REG, rowBits[row]);
+    delayMicroseconds(10);
+
+    uint64_t levels = readGpioLevels();
+    for (int col = 0; col < 3; col++) {
+      if (pinLow(levels, colPins[col])) keys |= 1u << INPUT_KEY_MATRIX(row, col);
+    }
+  }
+  idleRows();
+  delayMicroseconds(10);
+  inputScanning = false;
+
+  uint64_t levels = readGpioLevels();
+  if (pinLow(levels, CONFIRM_BUTTON_PIN)) keys |= 1u << INPUT_KEY_CONFIRM;
+  if (pinLow(levels, NEW_BREAD_BUTTON_PIN)) keys |= 1u << INPUT_KEY_NEW_BREAD;
+  return keys;
+}
+
+// Bit-sliced 2-bit vertical counters, one lane per key: a key's debounced
+// state flips only after it has read differently on 4 consecutive scans,
+// and any sample that agrees with the debounced state resets its lane.
+// Returns the keys that flipped.
+static uint16_t debounceKeys(uint16_t raw, uint16_t& stable) {
+  static uint16_t ct0 = 0xFFFF;
+  static uint16_t ct1 = 0xFFFF;
+
+  uint16_t delta = raw ^ stable;
+  ct0 = ~(ct0 & delta);
+  ct1 = ct0 ^ (ct1 & delta);
+  uint16_t toggled = delta & ct0 & ct1;
+  stable ^= toggled;
+  return toggled;
+}
+
+static void publish(InputEventType type, uint8_t key, uint16_t keys) {
+  InputEvent ev;
+  ev.type = type;
+  ev.key = key;
+  ev.keys = keys;
+  ev.at_us = (uint32_t)esp_timer_get_time();
+  ev.edge_us = inputEdgeUs ? inputEdgeUs : ev.at_us;
+  inputEdgeUs = 0;
+
+  if (type != INPUT_EVENT_REPEAT) {
+    uint32_t latency = ev.at_us - ev.edge_us;
+    inputEvents++;
+    inputLatencySum += latency;
+    if (latency > inputLatencyMax) inputLatencyMax = latency;
+  }
+
+  inputPostEvent(ev);
+}
+
+void inputTask(void* param) {
+  uint16_t stable = 0;    // debounced state
+  unsigned long repeatAt[INPUT_KEY_COUNT] = {0};
+  bool active = true;     // one scan at boot in case a key is already down
+
+  inputTaskHandle = xTaskGetCurrentTaskHandle();
+  attachInputInterrupts();
+
+  while (true) {
+    // Sleep until an edge; while anything is down or settling, scan on a tick
+    ulTaskNotifyTake(pdTRUE, active ? INPUT_SCAN_MS / portTICK_PERIOD_MS : portMAX_DELAY);
+    inputWakeups++;
+
+    uint32_t startCycles = ESP.getCycleCount();
+    uint16_t raw = readKeys();
+    uint16_t toggled = debounceKeys(raw, stable);
+    uint32_t cycles = ESP.getCycleCount() - startCycles;
+    inputScanCyclesSum += cycles;
+    if (cycles > inputScanCyclesMax) inputScanCyclesMax = cycles;
+
+    unsigned long now = millis();
+    uint16_t pressed = toggled & stable;
+
+    while (toggled) {
+      int k = __builtin_ctz(toggled);
+      toggled &= toggled - 1;
+      bool down = stable & (1u << k);
+      if (down) repeatAt[k] = now + INPUT_REPEAT_DELAY_MS;
+      publish(down ? INPUT_EVENT_PRESS : INPUT_EVENT_RELEASE, k, stable);
+    }
+
+    // A new key joining others already down makes a chord
+    if (pressed && __builtin_popcount(stable) >= 2) {
+      publish(INPUT_EVENT_CHORD, __builtin_ctz(pressed), stable);
+    }
+
+    // Auto-repeat only for a single +/- key held on its own
+    uint16_t held = stable & repeatKeys;
+    if (held && __builtin_popcount(stable) == 1) {
+      int k = __builtin_ctz(held);
+      if ((long)(now - repeatAt[k]) >= 0) {
+        repeatAt[k] = now + INPUT_REPEAT_MS;
+        publish(INPUT_EVENT_REPEAT, k, stable);
+      }
+    }
+
+    active = raw != 0 || stable != 0;
+    if (!active) inputEdgeUs = 0;
+  }
+}
+
+// ---------- PUBLIC API ----------
+void initInput() {
+  inputEventQueue = xQueueCreate(INPUT_EVENT_QUEUE_DEPTH, sizeof(InputEvent));
+
+  for (int i = 0; i < 3; i++) {
+    pinMode(rowPins[i], OUTPUT);
+  }
+  idleRows();
+
+  for (int i = 0; i < 3; i++) {
+    pinMode(colPins[i], INPUT_PULLUP);
+  }
+  pinMode(CONFIRM_BUTTON_PIN, INPUT_PULLUP);
+  pinMode(NEW_BREAD_BUTTON_PIN, INPUT_PULLUP);
+}
+
+bool inputNextEvent(InputEvent& ev, TickType_t wait) {
+  if (!inputEventQueue) return false;
+  return xQueueReceive(inputEventQueue, &ev, wait) == pdTRUE;
+}
+
+bool inputPostEvent(const InputEvent& ev, TickType_t wait) {
+  if (!inputEventQueue) return false;
+  return xQueueSend(inputEventQueue, &ev, wait) == pdTRUE;
+}
+
+InputStats getInputStats() {
+  InputStats st;
+  st.events = inputEvents;
+  st.wakeups = inputWakeups;
+  st.latency_avg_us = inputEvents ? (uint32_t)(inputLatencySum / inputEvents) : 0;
+  st.latency_max_us = inputLatencyMax;
+  st.scan_avg_cycles = inputWakeups ? (uint32_t)(inputScanCyclesSum / inputWakeups) : 0;
+  st.scan_max_cycles = inputScanCyclesMax;
+  inputEvents = 0;
+  inputWakeups = 0;
+  inputLatencySum = 0;
+  inputLatencyMax = 0;
+  inputScanCyclesSum = 0;
+  inputScanCyclesMax = 0;
+  return st;
+}
@@ -0,0 +1,18 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "config.h"
+#include "types.h"
+
+// ---------- INPUT SUBSYSTEM ----------
+// GPIO edge interrupts wake inputTask, which scans the keypad matrix and the
+// two buttons only while something is down and publishes debounced
+// press/release events to a single queue.
+void initInput();
+void inputTask(void* param);
+
+bool inputNextEvent(InputEvent& ev, TickType_t wait);
+bool inputPostEvent(const InputEvent& ev, TickType_t wait = 0);
+InputStats getInputStats();
+
+#endif
@@ -0,0 +1,238 @@
+#include "max7219.h"
+
+// ---------- REGISTERS ----------
+#define OP_NOOP        0
+#define OP_DIGIT0      1
+#define OP_DECODEMODE  9
+#define OP_INTENSITY   10
+#define OP_SCANLIMIT   11
+#define OP_SHUTDOWN    12
+#define OP_DISPLAYTEST 15
+
+// Segment bits are DP A B C D E F G, same as LedControl's charTable
+static const uint8_t hexSegments[16] = {
+  0x7E, 0x30, 0x6D, 0x79, 0x33, 0x5B, 0x5F, 0x70,
+  0x7F, 0x7B, 0x77, 0x1F, 0x0D, 0x3D, 0x4F, 0x47
+};
+
+static uint8_t charSegments(char c) {
+  if (c >= '0' && c <= '9') return hexSegments[c - '0'];
+  switch (c) {
+    case 'A': case 'a': return 0x77;
+    case 'B': case 'b': return 0x1F;
+    case 'C': case 'c': return 0x0D;
+    case 'D': case 'd': return 0x3D;
+    case 'E': case 'e': return 0x4F;
+    case 'F': case 'f': return 0x47;
+    case 'H': case 'h': return 0x37;
+    case 'L': case 'l': return 0x0E;
+    case 'P': case 'p': return 0x67;
+    case '-': return 0x01;
+    case '_': return 0x08;
+    case '.': case ',': return 0x80;
+    default:  return 0x00;
+  }
+}
+
+// ---------- MAX7219 CHAIN ----------
+Max7219Chain::Max7219Chain(int dataPin, int clkPin, int csPin, int numDevices)
+  : dataPin(dataPin), clkPin(clkPin), csPin(csPin),
+    numDevices(numDevices > DISPLAY_DEVICES ? DISPLAY_DEVICES : numDevices),
+    naiveBytes(0) {
+  memset(shadow, 0, sizeof(shadow));
+  memset(sent, 0, sizeof(sent));
+}
+
+void Max7219Chain::begin() {
+#if DISPLAY_BACKEND == DISPLAY_BACKEND_SPI
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num = dataPin;
+  bus.miso_io_num = -1;
+  bus.sclk_io_num = clkPin;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = sizeof(txBuf);
+
+  spi_device_interface_config_t dev = {};
+  dev.mode = 0;
+  dev.clock_speed_hz = DISPLAY_SPI_CLOCK_HZ;
+  dev.spics_io_num = csPin;  // the peripheral frames CS for every transaction
+  dev.queue_size = MAX7219_DIGITS;
+
+  if (spi_bus_initialize(VSPI_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK ||
+      spi_bus_add_device(VSPI_HOST, &dev, &spi) != ESP_OK) {
+    Serial.println("max7219: VSPI init failed");
+    spi = NULL;
+  }
+#else
+  pinMode(dataPin, OUTPUT);
+  pinMode(clkPin, OUTPUT);
+  pinMode(csPin, OUTPUT);
+  digitalWrite(csPin, HIGH);
+#endif
+  lock = xSemaphoreCreateMutex();
+  statsSince = millis();
+
+  for (int dev = 0; dev < numDevices; dev++) {
+    writeRegister(dev, OP_DISPLAYTEST, 0);
+    writeRegister(dev, OP_SCANLIMIT, 7);
+    writeRegister(dev, OP_DECODEMODE, 0);
+    writeRegister(dev, OP_SHUTDOWN, 0);
+  }
+
+  // Chip RAM is unknown after power-up: push every digit on the next flush
+  memset(shadow, 0, sizeof(shadow));
+  forceFull = true;
+}
+
+// Each frame is one chained transfer; the farthest device is shifted out
+// first. Caller holds the lock (or runs before begin() created it).
+void Max7219Chain::sendFrames(const Frame* frames, int count) {
+#if DISPLAY_BACKEND == DISPLAY_BACKEND_SPI
+  if (!spi) return;
+  int n = count > MAX7219_DIGITS ? MAX7219_DIGITS : count;
+
+  // Queue the whole batch so the peripheral runs the frames back to back,
+  // then reap the results
+  int queued = 0;
+  for (int i = 0; i < n; i++) {
+    uint8_t* tx = txBuf[i];
+    for (int dev = numDevices - 1; dev >= 0; dev--) {
+      *tx++ = frames[i][dev * 2];
+      *tx++ = frames[i][dev * 2 + 1];
+    }
+    memset(&trans[i], 0, sizeof(trans[i]));
+    trans[i].length = numDevices * 2 * 8;
+    trans[i].tx_buffer = txBuf[i];
+    if (spi_device_queue_trans(spi, &trans[i], portMAX_DELAY) != ESP_OK) break;
+    queued++;
+  }
+
+  spi_transaction_t* done;
+  for (int i = 0; i < queued; i++) {
+    spi_device_get_trans_result(spi, &done, portMAX_DELAY);
+  }
+  transactions += queued;
+  bytesWritten += queued * numDevices * 2;
+#else
+  for (int i = 0; i < count; i++) {
+    digitalWrite(csPin, LOW);
+    for (int dev = numDevices - 1; dev >= 0; dev--) {
+      shiftOut(dataPin, clkPin, MSBFIRST, frames[i][dev * 2]);
+      shiftOut(dataPin, clkPin, MSBFIRST, frames[i][dev * 2 + 1]);
+    }
+    digitalWrite(csPin, HIGH);
+  }
+  transactions += count;
+  bytesWritten += count * numDevices * 2;
+#endif
+}
+
+// Control registers are rare, so they are written through immediately
+void Max7219Chain::writeRegister(int addr, uint8_t opcode, uint8_t data) {
+  Frame frame = {0};
+  frame[addr * 2] = opcode;
+  frame[addr * 2 + 1] = data;
+
+  if (lock) xSemaphoreTake(lock, portMAX_DELAY);
+  sendFrames(&frame, 1);
+  if (lock) xSemaphoreGive(lock);
+}
+
+void Max7219Chain::shutdown(int addr, bool b) {
+  if (addr < 0 || addr >= numDevices) return;
+  writeRegister(addr, OP_SHUTDOWN, b ? 0 : 1);
+}
+
+void Max7219Chain::setIntensity(int addr, int intensity) {
+  if (addr < 0 || addr >= numDevices || intensity < 0 || intensity > 15) return;
+  writeRegister(addr, OP_INTENSITY, intensity);
+}
+
+void Max7219Chain::clearDisplay(int addr) {
+  if (addr < 0 || addr >= numDevices) return;
+  memset(shadow[addr], 0, MAX7219_DIGITS);
+  naiveBytes.fetch_add(MAX7219_DIGITS * numDevices * 2, std::memory_order_relaxed);
+}
+
+void Max7219Chain::setRow(int addr, int row, uint8_t value) {
+  if (addr < 0 || addr >= numDevices || row < 0 || row >= MAX7219_DIGITS) return;
+  shadow[addr][row] = value;
+  naiveBytes.fetch_add(numDevices * 2, std::memory_order_relaxed);
+}
+
+void Max7219Chain::setDigit(int addr, int digit, uint8_t value, bool dp) {
+  if (value > 15) return;
+  setRow(addr, digit, hexSegments[value] | (dp ? 0x80 : 0));
+}
+
+void Max7219Chain::setChar(int addr, int digit, char value, bool dp) {
+  setRow(addr, digit, charSegments(value) | (dp ? 0x80 : 0));
+}
+
+void Max7219Chain::flush() {
+  if (!lock) return;
+  xSemaphoreTake(lock, portMAX_DELAY);
+
+  // Snapshot the dirty digits per device
+  uint8_t dirtyDigit[DISPLAY_DEVICES][MAX7219_DIGITS];
+  uint8_t dirtyValue[DISPLAY_DEVICES][MAX7219_DIGITS];
+  int dirtyCount[DISPLAY_DEVICES] = {0};
+  int transfers = 0;
+
+  for (int dev = 0; dev < numDevices; dev++) {
+    for (int d = 0; d < MAX7219_DIGITS; d++) {
+      uint8_t v = shadow[dev][d];
+      if (forceFull || v != sent[dev][d]) {
+        dirtyDigit[dev][dirtyCount[dev]] = d;
+        dirtyValue[dev][dirtyCount[dev]] = v;
+        dirtyCount[dev]++;
+      }
+    }
+    if (dirtyCount[dev] > transfers) transfers = dirtyCount[dev];
+  }
+  forceFull = false;
+
+  // Each transfer carries one dirty digit per device (NOOP when a device
+  // has run out), so the frame costs max(dirty per device) transfers.
+  Frame frames[MAX7219_DIGITS];
+  memset(frames, 0, sizeof(frames));
+  for (int t = 0; t < transfers; t++) {
+    for (int dev = 0; dev < numDevices; dev++) {
+      if (t >= dirtyCount[dev]) continue;
+      uint8_t d = dirtyDigit[dev][t];
+      frames[t][dev * 2] = OP_DIGIT0 + d;
+      frames[t][dev * 2 + 1] = dirtyValue[dev][t];
+      sent[dev][d] = dirtyValue[dev][t];
+      digitsWritten++;
+    }
+  }
+  if (transfers > 0) {
+    sendFrames(frames, transfers);
+    flushes++;
+  }
+
+  xSemaphoreGive(lock);
+}
+
+DisplayStats Max7219Chain::takeStats() {
+  DisplayStats st;
+  unsigned long now = millis();
+  unsigned long elapsed = now - statsSince;
+  if (elapsed == 0) elapsed = 1;
+
+  if (lock) xSemaphoreTake(lock, portMAX_DELAY);
+  st.bytes_per_sec = (uint32_t)((uint64_t)bytesWritten * 1000 / elapsed);
+  st.flushes = flushes;
+  st.digits_written = digitsWritten;
+  st.transactions = transactions;
+  bytesWritten = 0;
+  transactions = 0;
+  flushes = 0;
+  digitsWritten = 0;
+  statsSince = now;
+  if (lock) xSemaphoreGive(lock);
+
+  st.naive_bytes_per_sec = (uint32_t)((uint64_t)naiveBytes.exchange(0) * 1000 / elapsed);
+  return st;
+}
@@ -0,0 +1,64 @@
+#ifndef MAX7219_H
+#define MAX7219_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "types.h"
+#if DISPLAY_BACKEND == DISPLAY_BACKEND_SPI
+#include <driver/spi_master.h>
+#endif
+
+#define MAX7219_DIGITS 8
+
+// ---------- MAX7219 CHAIN ----------
+// Drop-in for the LedControl calls the sketch uses, backed by a shadow
+// framebuffer. Setters only touch RAM; flush() diffs the shadow against what
+// the chips already hold and clocks out just the dirty digits, one digit
+// register per device per chained transfer. Transfers go out either
+// bit-banged or as queued VSPI/DMA transactions (DISPLAY_BACKEND).
+class Max7219Chain {
+public:
+  Max7219Chain(int dataPin, int clkPin, int csPin, int numDevices);
+
+  void begin();
+  void shutdown(int addr, bool b);
+  void setIntensity(int addr, int intensity);
+  void clearDisplay(int addr);
+  void setRow(int addr, int row, uint8_t value);
+  void setDigit(int addr, int digit, uint8_t value, bool dp);
+  void setChar(int addr, int digit, char value, bool dp);
+  void flush();
+
+  // Rates are over the time since the previous call
+  DisplayStats takeStats();
+
+private:
+  // One frame = one CS cycle: (opcode, data) per device, device 0 first
+  typedef uint8_t Frame[DISPLAY_DEVICES * 2];
+
+  void writeRegister(int addr, uint8_t opcode, uint8_t data);
+  void sendFrames(const Frame* frames, int count);
+
+  int dataPin, clkPin, csPin, numDevices;
+  SemaphoreHandle_t lock = NULL;
+  uint8_t shadow[DISPLAY_DEVICES][MAX7219_DIGITS];
+  uint8_t sent[DISPLAY_DEVICES][MAX7219_DIGITS];
+  bool forceFull = true;
+
+#if DISPLAY_BACKEND == DISPLAY_BACKEND_SPI
+  spi_device_handle_t spi = NULL;
+  spi_transaction_t trans[MAX7219_DIGITS];
+  // Wire order (farthest device first), kept here so DMA can read it
+  WORD_ALIGNED_ATTR uint8_t txBuf[MAX7219_DIGITS][DISPLAY_DEVICES * 2];
+#endif
+
+  std::atomic<uint32_t> naiveBytes;
+  uint32_t bytesWritten = 0;
+  uint32_t transactions = 0;
+  uint32_t flushes = 0;
+  uint32_t digitsWritten = 0;
+  unsigned long statsSince = 0;
+};
+
+#endif
@@ -2,114 +2,475 @@
 #include "network.h"
 #include "api.h"
 #include "mutex.h"
+#include "tasks.h"
+#include "errors.h"
+#include "display.h"
+#include "input.h"
+#include "flow.h"
+#include "scanner.h"
+#include "waitlist.h"
+#include "buzzer.h"
+#include "printer.h"
+#include "customer_display.h"
 #include <ArduinoJson.h>
 
-// ---------- MQTT QUEUE MANAGEMENT ----------
-SemaphoreHandle_t mqttQueueMutex;
-std::deque<MqttMessage> mqttMessageQueue;
-
-bool queueMqttMessage(const String& topic, const String& payload, bool retain) {
-  if (xSemaphoreTake(mqttQueueMutex, MQTT_QUEUE_TIMEOUT / portTICK_PERIOD_MS) == pdTRUE) {
-    if (mqttMessageQueue.size() < MAX_MQTT_QUEUE_SIZE) {
-      MqttMessage msg;
-      msg.topic = topic;
-      msg.payload = payload;
-      msg.retain = retain;
-      mqttMessageQueue.push_back(msg);
-      xSemaphoreGive(mqttQueueMutex);
-      return true;
-    }
-    xSemaphoreGive(mqttQueueMutex);
-  }
-  return false;
-}
+// ---------- MQTT OUTBOUND BATCHING ----------
+// Consumer-side counters, only touched by networkTask
+static uint32_t mqttPublished = 0;
+static uint32_t mqttHighWater = 0;
 
-void mqttPublishError(const String& msg) {
-  queueMqttMessage(topic_errors, msg, true);
+// Batching: flush window bounds and per-stats-window metrics
+static uint32_t mqttFlushWindowMinMs = MQTT_FLUSH_WINDOW_MIN_MS;
+static uint32_t mqttFlushWindowMaxMs = MQTT_FLUSH_WINDOW_MAX_MS;
+static uint32_t mqttFlushWindowMs = MQTT_FLUSH_WINDOW_MIN_MS;
+static uint32_t mqttPublishCalls = 0;
+static uint32_t mqttPublishFailed = 0;
+static uint32_t mqttPublishAbandoned = 0;
+static uint32_t mqttBatchedMessages = 0;   // messages carried by mqttPublishCalls
+static uint32_t mqttFlushLatencySum = 0;
+static uint32_t mqttFlushLatencyMax = 0;
+static uint32_t mqttFlushes = 0;
+
+const String& mqttTopicName(MqttTopicId topic) {
+  switch (topic) {
+    case MQTT_TOPIC_BREAD_TIME: return topic_bread_time;
+    case MQTT_TOPIC_STATS:      return topic_stats;
+    case MQTT_TOPIC_ERROR:
+    default:                    return topic_errors;
+  }
 }
 
-void mqttPublish(const String& topic, const String& payload, bool retain) {
+void mqttPublish(MqttTopicId topic, const String& payload, bool retain) {
   queueMqttMessage(topic, payload, retain);
 }
 
 void mqttPublishBreadTime(const String& payload) {
-  queueMqttMessage(topic_bread_time, payload, false);
+  queueMqttMessage(MQTT_TOPIC_BREAD_TIME, payload, false);
+}
+
+void mqttSetFlushWindow(uint32_t minMs, uint32_t maxMs) {
+  if (minMs == 0) minMs = 1;
+  if (maxMs < minMs) maxMs = minMs;
+  mqttFlushWindowMinMs = minMs;
+  mqttFlushWindowMaxMs = maxMs;
+  mqttFlushWindowMs = minMs;
+}
+
+// Enqueue latency figures cover the window since the previous call
+MqttQueueStats getMqttQueueStats() {
+  MqttQueueStats st;
+  takeMqttRingStats(st);
+  st.published = mqttPublished;
+  st.high_water = mqttHighWater;
+
+  st.publish_calls = mqttPublishCalls;
+  st.publish_failed = mqttPublishFailed;
+  st.publish_abandoned = mqttPublishAbandoned;
+  st.msgs_per_publish_x100 = mqttPublishCalls ? (mqttBatchedMessages * 100UL) / mqttPublishCalls : 0;
+  st.flush_latency_avg_ms = mqttFlushes ? mqttFlushLatencySum / mqttFlushes : 0;
+  st.flush_latency_max_ms = mqttFlushLatencyMax;
+  st.flush_window_ms = mqttFlushWindowMs;
+  mqttPublishCalls = 0;
+  mqttPublishFailed = 0;
+  mqttPublishAbandoned = 0;
+  mqttBatchedMessages = 0;
+  mqttFlushLatencySum = 0;
+  mqttFlushLatencyMax = 0;
+  mqttFlushes = 0;
+  return st;
 }
 
-int getMqttQueueSize() {
-  int size = 0;
-  if (xSemaphoreTake(mqttQueueMutex, 100 / portTICK_PERIOD_MS) == pdTRUE) {
-    size = mqttMessageQueue.size();
-    xSemaphoreGive(mqttQueueMutex);
+// Config refresh counters (see CONFIG REFRESH WORKER below)
+static uint32_t configRequests = 0;
+static uint32_t configFetches = 0;
+static uint32_t configInlineApplied = 0;
+
+// Runs on networkTask and publishes directly, so stats never compete
+// with (or get dropped from) the outbound ring they describe. The document
+// is static to keep ~2 KB off the network task stack.
+void mqttPublishStats() {
+  static StaticJsonDocument<2048> doc;
+  doc.clear();
+
+  HttpSessionStats http = getHttpSessionStats();
+  doc["http_requests"] = http.requests;
+  doc["http_reused"] = http.reused;
+  doc["http_reconnects"] = http.reconnects;
+  doc["http_reuse_pct"] = http.requests ? (http.reused * 100UL) / http.requests : 0;
+
+  // Per endpoint: [calls, heap bytes of last call, max heap bytes per call]
+  JsonObject heap = doc.createNestedObject("api_heap");
+  for (int i = 0; i < API_ENDPOINT_COUNT; i++) {
+    ApiHeapStats st = getApiHeapStats((ApiEndpoint)i);
+    JsonArray entry = heap.createNestedArray(apiEndpointName((ApiEndpoint)i));
+    entry.add(st.calls);
+    entry.add(st.last_bytes);
+    entry.add(st.max_bytes);
   }
-  return size;
+
+  MqttQueueStats q = getMqttQueueStats();
+  doc["mq_enqueued"] = q.enqueued;
+  doc["mq_published"] = q.published;
+  doc["mq_dropped"] = q.dropped;
+  doc["mq_truncated"] = q.truncated;
+  doc["mq_high_water"] = q.high_water;
+  doc["mq_enq_avg_cyc"] = q.enqueue_avg_cycles;
+  doc["mq_enq_max_cyc"] = q.enqueue_max_cycles;
+  doc["mq_publishes"] = q.publish_calls;
+  doc["mq_publish_failed"] = q.publish_failed;
+  doc["mq_publish_abandoned"] = q.publish_abandoned;
+  doc["mq_msgs_per_pub_x100"] = q.msgs_per_publish_x100;
+  doc["mq_flush_lat_avg_ms"] = q.flush_latency_avg_ms;
+  doc["mq_flush_lat_max_ms"] = q.flush_latency_max_ms;
+  doc["mq_flush_window_ms"] = q.flush_window_ms;
+  doc["err_suppressed"] = getSuppressedErrorCount();
+  doc["cfg_requests"] = configRequests;
+  doc["cfg_fetches"] = configFetches;
+  doc["cfg_inline"] = configInlineApplied;
+
+  DisplayStats disp = getDisplayStats();
+  doc["disp_bytes_s"] = disp.bytes_per_sec;
+  doc["disp_naive_bytes_s"] = disp.naive_bytes_per_sec;
+  doc["disp_flushes"] = disp.flushes;
+  doc["disp_txns"] = disp.transactions;
+  doc["disp_digits"] = disp.digits_written;
+  doc["disp_intents"] = disp.intents;
+  doc["disp_frames"] = disp.frames;
+
+  uint32_t ordersOk, ordersFailed;
+  getOrderStats(ordersOk, ordersFailed);
+  doc["ord_depth"] = getOrderQueueDepth();
+  doc["ord_ok"] = ordersOk;
+  doc["ord_failed"] = ordersFailed;
+  doc["flow_state"] = flowGetState();
+  doc["net_bits"] = (uint32_t)netGetBits();
+  doc["net_transitions"] = getNetTransitionCount();
+  uint32_t flowRejected = getFlowRejectedCount();
+  doc["flow_rejected"] = flowRejected;
+  // A rejected event means a caller and the flow disagreed; dump the
+  // transitions that led there while they are still in the log
+  static uint32_t flowRejectedLogged = 0;
+  if (flowRejected != flowRejectedLogged) {
+    flowRejectedLogged = flowRejected;
+    flowPrintLog();
+  }
+
+  ScannerStats scan = getScannerStats();
+  doc["scan_ok"] = scan.scans;
+  doc["scan_other_bakery"] = scan.other_bakery;
+  doc["scan_malformed"] = scan.malformed;
+  doc["scan_dropped"] = scan.dropped;
+  doc["scan_served"] = scan.served;
+  doc["scan_submit_avg_us"] = scan.submit_avg_us;
+  doc["scan_submit_max_us"] = scan.submit_max_us;
+  doc["scan_result_avg_ms"] = scan.result_avg_ms;
+  doc["scan_result_max_ms"] = scan.result_max_ms;
+  doc["scan_cache_hits"] = scan.cache_hits;
+  doc["scan_cache_misses"] = scan.cache_misses;
+
+  WaitListStats wl = getWaitListStats();
+  doc["wl_size"] = wl.size;
+  doc["wl_deltas"] = wl.deltas;
+  doc["wl_hits"] = wl.hits;
+  doc["wl_corrections"] = wl.corrections;
+  doc["wl_reverts"] = wl.reverts;
+
+  BuzzerStats buzz = getBuzzerStats();
+  doc["buzz_played"] = buzz.played;
+  doc["buzz_preempted"] = buzz.preempted;
+  doc["buzz_ignored"] = buzz.ignored;
+
+  PrinterStats prn = getPrinterStats();
+  doc["prn_tickets"] = prn.tickets;
+  doc["prn_voided"] = prn.voided;
+  doc["prn_dropped"] = prn.dropped;
+  doc["prn_bytes"] = prn.bytes;
+  doc["prn_busy_ms"] = prn.busy_ms;
+  doc["prn_capacity_tpm"] = prn.capacity_tpm;
+
+  BootStats boot = getBootStats();
+  doc["boot_warm"] = boot.warm;
+  doc["boot_ready_ms"] = boot.ready_ms;
+  doc["boot_synced_ms"] = boot.synced_ms;
+
+  CustomerDisplayStats dl = getCustomerDisplayStats();
+  doc["dl_frames"] = dl.frames;
+  doc["dl_retransmits"] = dl.retransmits;
+  doc["dl_acks"] = dl.acks;
+  doc["dl_send_fail"] = dl.send_fail;
+  doc["dl_calls_dropped"] = dl.calls_dropped;
+  doc["dl_ack_avg_ms"] = dl.ack_avg_ms;
+  doc["dl_ack_max_ms"] = dl.ack_max_ms;
+
+  InputStats in = getInputStats();
+  doc["in_events"] = in.events;
+  doc["in_wakeups"] = in.wakeups;
+  doc["in_lat_avg_us"] = in.latency_avg_us;
+  doc["in_lat_max_us"] = in.latency_max_us;
+  doc["in_scan_avg_cyc"] = in.scan_avg_cycles;
+  doc["in_scan_max_cyc"] = in.scan_max_cycles;
+
+  String payload; serializeJson(doc, payload);
+  mqtt.publish(topic_stats.c_str(), payload.c_str(), false);
 }
 
-void mqttPublisherTask(void* param) {
-  unsigned long lastQueueCheck = 0;
-  int queueOverflowCount = 0;
-  
-  while (true) {
-    if (mqtt.connected()) {
-      if (xSemaphoreTake(mqttQueueMutex, 100 / portTICK_PERIOD_MS) == pdTRUE) {
-        if (!mqttMessageQueue.empty()) {
-          MqttMessage msg = mqttMessageQueue.front();
-          mqttMessageQueue.pop_front();
-          xSemaphoreGive(mqttQueueMutex);
-          
-          bool published = mqtt.publish(msg.topic.c_str(), msg.payload.c_str(), msg.retain);
-          if (!published) {
-            if (!mqtt.connected()) {
-              Serial.println("MQTT disconnected during publish");
-            } else {
-              Serial.println("MQTT publish failed: " + msg.topic + " -> " + msg.payload);
-            }
-          }
-        } else {
-          xSemaphoreGive(mqttQueueMutex);
-        }
-        
-        if (millis() - lastQueueCheck > 5000) {
-          lastQueueCheck = millis();
-          int queueSize = mqttMessageQueue.size();
-          if (queueSize > MAX_MQTT_QUEUE_SIZE * 0.8) {
-            queueOverflowCount++;
-            if (queueOverflowCount > 3) {
-              int clearCount = queueSize / 2;
-              for (int i = 0; i < clearCount; i++) {
-                mqttMessageQueue.pop_front();
-              }
-              queueOverflowCount = 0;
-              Serial.println("MQTT queue overflow - cleared " + String(clearCount) + " messages");
-            }
-          } else {
-            queueOverflowCount = 0;
-          }
-        }
+// ---------- BATCHED FLUSH ----------
+// All messages committed when a flush window ends are published together,
+// one PUBLISH per (topic, retain) group. A lone message goes out unchanged;
+// two or more are framed into a single payload:
+//
+//   !batch <count>\n
+//   <len>\n<payload>\n      (repeated <count> times)
+//
+// Payloads are written straight from the ring without copying. A slot is
+// marked sent once its group is out, and only the run of sent slots at the
+// tail is released, so a group that failed keeps its slots (and everything
+// queued behind them) for the next window.
+static size_t batchHeader(char* buf, size_t len, uint32_t count) {
+  return snprintf(buf, len, "!batch %lu\n", (unsigned long)count);
+}
+
+static size_t frameHeader(char* buf, size_t len, uint16_t payloadLen) {
+  return snprintf(buf, len, "%u\n", (unsigned)payloadLen);
+}
+
+// members: ring offsets of the group's slots, oldest first
+static bool publishGroup(const uint8_t* members, uint32_t groupCount, uint8_t topic, bool retain) {
+  const String& topicName = mqttTopicName((MqttTopicId)topic);
+
+  if (groupCount == 1) {
+    MqttSlot* slot = peekMqttSlot(members[0]);
+    return mqtt.publish(topicName.c_str(), (const uint8_t*)slot->payload, slot->len, retain);
+  }
+
+  char hdr[24];
+  size_t total = batchHeader(hdr, sizeof(hdr), groupCount);
+  for (uint32_t i = 0; i < groupCount; i++) {
+    MqttSlot* slot = peekMqttSlot(members[i]);
+    total += frameHeader(hdr, sizeof(hdr), slot->len) + slot->len + 1;
+  }
+
+  if (!mqtt.beginPublish(topicName.c_str(), total, retain)) return false;
+  size_t n = batchHeader(hdr, sizeof(hdr), groupCount);
+  mqtt.write((const uint8_t*)hdr, n);
+  for (uint32_t i = 0; i < groupCount; i++) {
+    MqttSlot* slot = peekMqttSlot(members[i]);
+    n = frameHeader(hdr, sizeof(hdr), slot->len);
+    mqtt.write((const uint8_t*)hdr, n);
+    mqtt.write((const uint8_t*)slot->payload, slot->len);
+    mqtt.write((const uint8_t*)"\n", 1);
+  }
+  return mqtt.endPublish() == 1;
+}
+
+static void flushMqttRing() {
+  uint32_t count = 0;
+  while (count < MQTT_RING_SIZE && peekMqttSlot(count)) count++;
+  if (count == 0) return;
+
+  if (count > mqttHighWater) mqttHighWater = count;
+  uint32_t latency = millis() - peekMqttSlot(0)->queued_at;
+
+  // Groups are visited in order of first appearance; `done` marks slots
+  // already sent or already visited as part of a group.
+  bool done[MQTT_RING_SIZE];
+  uint8_t members[MQTT_RING_SIZE];
+  for (uint32_t i = 0; i < count; i++) done[i] = peekMqttSlot(i)->sent;
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (done[i]) continue;
+    MqttSlot* first = peekMqttSlot(i);
+    uint32_t groupCount = 0;
+    for (uint32_t k = i; k < count; k++) {
+      MqttSlot* slot = peekMqttSlot(k);
+      if (!done[k] && slot->topic == first->topic && slot->retain == first->retain) {
+        done[k] = true;
+        members[groupCount++] = k;
+      }
+    }
+
+    if (publishGroup(members, groupCount, first->topic, first->retain)) {
+      for (uint32_t k = 0; k < groupCount; k++) peekMqttSlot(members[k])->sent = true;
+      mqttPublished += groupCount;
+      mqttPublishCalls++;
+      mqttBatchedMessages += groupCount;
+      continue;
+    }
+
+    mqttPublishFailed++;
+    if (!mqtt.connected()) {
+      // Everything not yet sent waits for the next session
+      Serial.println("MQTT disconnected during publish, keeping " + String(groupCount) + " msgs");
+      break;
+    }
+
+    // Connected but refused: retry next window, give up after a few tries
+    Serial.println("MQTT publish failed: " + mqttTopicName((MqttTopicId)first->topic) + " (" + String(groupCount) + " msgs)");
+    for (uint32_t k = 0; k < groupCount; k++) {
+      MqttSlot* slot = peekMqttSlot(members[k]);
+      if (++slot->attempts >= MQTT_PUBLISH_ATTEMPTS) {
+        slot->sent = true;
+        mqttPublishAbandoned++;
       }
     }
-    vTaskDelay(100 / portTICK_PERIOD_MS);
+  }
+
+  uint32_t released = 0;
+  while (released < count && peekMqttSlot(released)->sent) released++;
+  releaseMqttSlots(released);
+
+  mqttFlushes++;
+  mqttFlushLatencySum += latency;
+  if (latency > mqttFlushLatencyMax) mqttFlushLatencyMax = latency;
+
+  // Adapt: back off to the minimum when the ring is getting full or traffic
+  // is a trickle; stretch the window while bursts keep arriving so they
+  // collapse into fewer publishes.
+  if (count >= MQTT_RING_SIZE / 2 || count <= 1) {
+    uint32_t shrunk = mqttFlushWindowMs / 2;
+    mqttFlushWindowMs = shrunk > mqttFlushWindowMinMs ? shrunk : mqttFlushWindowMinMs;
+  } else {
+    uint32_t grown = mqttFlushWindowMs + MQTT_FLUSH_WINDOW_STEP_MS;
+    mqttFlushWindowMs = grown < mqttFlushWindowMaxMs ? grown : mqttFlushWindowMaxMs;
+  }
+}
+
+// Called from networkTask every tick while the broker is connected
+void mqttOutboundTick(bool forceFlush) {
+  static unsigned long lastFlush = 0;
+  static unsigned long lastStatsPublish = 0;
+
+  if (millis() - lastStatsPublish > STATS_PUBLISH_INTERVAL) {
+    lastStatsPublish = millis();
+    mqttPublishStats();
+  }
+
+  if (forceFlush || millis() - lastFlush >= mqttFlushWindowMs) {
+    lastFlush = millis();
+    errorsTick();
+    flushMqttRing();
   }
 }
 
-void fetchInitFromMqttTask(void* param) {
-    if (!isNetworkReadyForApi()) {
-        mqttPublishError("init:network_not_ready");
-        vTaskDelete(NULL);
+// ---------- CONFIG REFRESH WORKER ----------
+// bread_time messages only wake this one worker. Whatever arrives while a
+// refresh is pending is folded into it, so a burst of N retained/repeated
+// updates costs one /hardware_init round trip, or none at all when the
+// messages carry bread_id -> cook_time entries. Inline entries are partial:
+// they are merged by bread id, both into the pending update and into the
+// config, and a pending refetch absorbs them (the server already has them).
+static TaskHandle_t configRefreshHandle = NULL;
+static portMUX_TYPE configRefreshMux = portMUX_INITIALIZER_UNLOCKED;
+static int configPendingIds[MAX_KEYS];
+static int configPendingTimes[MAX_KEYS];
+static int configPendingCount = -1;  // -1 = fetch from /hardware_init
+static bool configPending = false;
+
+// ids/times NULL (or count < 0) means "refetch"; otherwise merge inline
+static void requestConfigRefresh(const int* ids, const int* times, int count) {
+  portENTER_CRITICAL(&configRefreshMux);
+  if (!ids || !times || count < 0) {
+    configPendingCount = -1;
+  } else if (!configPending || configPendingCount >= 0) {
+    if (!configPending) configPendingCount = 0;
+    for (int i = 0; i < count && configPendingCount >= 0; i++) {
+      int k = 0;
+      while (k < configPendingCount && configPendingIds[k] != ids[i]) k++;
+      if (k == MAX_KEYS) {
+        configPendingCount = -1;  // more distinct breads than a config holds
+        break;
+      }
+      configPendingIds[k] = ids[i];
+      configPendingTimes[k] = times[i];
+      if (k == configPendingCount) configPendingCount++;
     }
+  }
+  configPending = true;
+  configRequests++;
+  portEXIT_CRITICAL(&configRefreshMux);
 
+  if (configRefreshHandle) xTaskNotifyGive(configRefreshHandle);
+}
+
+// Drops the pending update once handled, unless another one was folded in
+// meanwhile (re-applying the entries it already held is harmless)
+static void finishConfigRefresh(uint32_t seenRequests) {
+  portENTER_CRITICAL(&configRefreshMux);
+  if (configRequests == seenRequests) configPending = false;
+  portEXIT_CRITICAL(&configRefreshMux);
+}
+
+static bool runConfigRefresh() {
+  int ids[MAX_KEYS];
+  int times[MAX_KEYS];
+
+  portENTER_CRITICAL(&configRefreshMux);
+  bool pending = configPending;
+  int count = configPendingCount;
+  for (int i = 0; i < count; i++) {
+    ids[i] = configPendingIds[i];
+    times[i] = configPendingTimes[i];
+  }
+  uint32_t seenRequests = configRequests;
+  portEXIT_CRITICAL(&configRefreshMux);
+
+  if (!pending) return true;
+
+  if (count >= 0) {
     if (!tryLockBusy()) {
-        mqttPublishError("❌ Device busy");
-        vTaskDelete(NULL);
+      reportError(ERR_MQTT_INIT_BUSY);
+      return false;
     }
+    bool merged = mergeBreadTimes(ids, times, count);
+    unlockBusy();
 
-    bool ok = fetchInitData();
-    if (!ok) {
-        mqttPublishError("failed");
+    if (merged) {
+      configInlineApplied++;
+      finishConfigRefresh(seenRequests);
+      return true;
     }
-    
-    unlockBusy();
-    vTaskDelete(NULL);
+    // An id we don't have: the bread layout changed, fall through to a refetch
+  }
+
+  // A full fetch needs the API; give a reconnect in progress one retry period
+  if (!netWaitFor(NET_API_BITS, INIT_RETRY_DELAY / portTICK_PERIOD_MS)) {
+    reportError(ERR_MQTT_INIT_NOT_READY);
+    return false;
+  }
+
+  if (!tryLockBusy()) {
+    reportError(ERR_MQTT_INIT_BUSY);
+    return false;
+  }
+  configFetches++;
+  bool ok = fetchInitData();
+  unlockBusy();
+
+  if (!ok) {
+    reportError(ERR_MQTT_INIT_FETCH);
+    return false;
+  }
+  finishConfigRefresh(seenRequests);
+  return true;
+}
+
+static void configRefreshTask(void* param) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // Let the rest of a burst land before acting on it
+    while (ulTaskNotifyTake(pdTRUE, CONFIG_REFRESH_COALESCE_MS / portTICK_PERIOD_MS) > 0) {}
+
+    if (!runConfigRefresh()) {
+      // Keep the update pending and try again later
+      vTaskDelay(INIT_RETRY_DELAY / portTICK_PERIOD_MS);
+      xTaskNotifyGive(configRefreshHandle);
+    }
+  }
+}
+
+void initConfigRefresh() {
+  xTaskCreatePinnedToCore(configRefreshTask, "ConfigRefresh", 6144, NULL, 1, &configRefreshHandle, 1);
 }
 
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
@@ -120,10 +481,23 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
 
     // --------- Existing bread_time handling ---------
     if (String(topic) == topic_bread_time) {
-        xTaskCreatePinnedToCore(
-            fetchInitFromMqttTask,
-            "FetchInitOnMqtt", 4096, NULL, 1, NULL, 1
-        );
+        // A non-empty {"<bread_id>": <cook_time>, ...} payload updates just
+        // those breads; anything else just means "refetch /hardware_init".
+        StaticJsonDocument<512> doc;
+        int ids[MAX_KEYS];
+        int times[MAX_KEYS];
+        int n = -1;
+        if (length > 0 && !deserializeJson(doc, (const char*)payload, length)) {
+            JsonObjectConst map = doc.as<JsonObjectConst>();
+            if (!map.isNull() && map.size() > 0) {
+                n = parseBreadTimeMap(map, ids, times);
+            }
+        }
+        if (n > 0) {
+            requestConfigRefresh(ids, times, n);
+        } else {
+            requestConfigRefresh(NULL, NULL, -1);
+        }
         return;
     }
 
@@ -134,12 +508,39 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
         if (!err && doc.containsKey("state")) {
             hasCustomerInQueue = doc["state"] | false;
             Serial.println("MQTT update: hasCustomerInQueue = " + String(hasCustomerInQueue));
+            if (hasCustomerInQueue) {
+                requestTicketFlowPoll();
+            }
         } else {
             Serial.println("MQTT invalid payload for customer queue: " + payloadStr);
         }
         return;
     }
 
+    // --------- Full current-ticket state pushed by the server ---------
+    if (String(topic) == topic_current_ticket) {
+        StaticJsonDocument<384> doc;
+        DeserializationError err = deserializeJson(doc, (const char*)payload, length);
+        if (!err && doc.containsKey("current_ticket_id")) {
+            CurrentTicketState state;
+            parseCurrentTicketState(doc.as<JsonVariantConst>(), state);
+            pushCurrentTicketState(state);
+        } else {
+            Serial.println("MQTT invalid payload for current ticket: " + payloadStr);
+        }
+        return;
+    }
+
+    // --------- Wait-list delta for the local mirror ---------
+    if (String(topic) == topic_wait_list) {
+        StaticJsonDocument<256> doc;
+        DeserializationError err = deserializeJson(doc, (const char*)payload, length);
+        if (err || !waitListApplyDelta(doc.as<JsonVariantConst>())) {
+            Serial.println("MQTT invalid payload for wait list: " + payloadStr);
+        }
+        return;
+    }
+
     // // --------- Update hasUpcomingCustomerInQueue ---------
     // if (String(topic) == topic_upcoming_queue) {
     //     StaticJsonDocument<64> doc;
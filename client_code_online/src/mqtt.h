@@ -3,21 +3,21 @@
 
 #include "config.h"
 #include "types.h"
+#include "mqtt_ring.h"
 
-// ---------- MQTT QUEUE MANAGEMENT ----------
-extern SemaphoreHandle_t mqttQueueMutex;
-extern std::deque<MqttMessage> mqttMessageQueue;
+// ---------- MQTT OUTBOUND BATCHING ----------
+const String& mqttTopicName(MqttTopicId topic);
+MqttQueueStats getMqttQueueStats();
+void mqttSetFlushWindow(uint32_t minMs, uint32_t maxMs);
 
 // ---------- MQTT FUNCTIONS ----------
-bool queueMqttMessage(const String& topic, const String& payload, bool retain = false);
-void mqttPublishError(const String& msg);
-void mqttPublish(const String& topic, const String& payload, bool retain = false);
+void mqttPublish(MqttTopicId topic, const String& payload, bool retain = false);
 void mqttPublishBreadTime(const String& payload);
-int getMqttQueueSize();
+void mqttPublishStats();
 
 // ---------- MQTT TASKS ----------
-void mqttPublisherTask(void* param);
-void fetchInitFromMqttTask(void* param);
+void mqttOutboundTick(bool forceFlush);
+void initConfigRefresh();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 
 #endif
@@ -0,0 +1,98 @@
+#include "mqtt_ring.h"
+
+static_assert((MQTT_RING_SIZE & (MQTT_RING_SIZE - 1)) == 0, "MQTT_RING_SIZE must be a power of two");
+
+static MqttSlot mqttRing[MQTT_RING_SIZE];
+static std::atomic<uint32_t> mqttRingHead(0);
+static uint32_t mqttRingTail = 0;
+
+// Bumped from many tasks, so they are atomics
+static std::atomic<uint32_t> mqttEnqueued(0);
+static std::atomic<uint32_t> mqttDropped(0);
+static std::atomic<uint32_t> mqttTruncated(0);
+static std::atomic<uint32_t> mqttEnqueueCycles(0);     // since last stats publish
+static std::atomic<uint32_t> mqttEnqueueSamples(0);    // since last stats publish
+static std::atomic<uint32_t> mqttEnqueueMaxCycles(0);
+
+void initMqttQueue() {
+  for (uint32_t i = 0; i < MQTT_RING_SIZE; i++) {
+    mqttRing[i].seq.store(i, std::memory_order_relaxed);
+  }
+  mqttRingHead.store(0, std::memory_order_relaxed);
+  mqttRingTail = 0;
+}
+
+bool queueMqttMessage(MqttTopicId topic, const char* payload, size_t len, bool retain) {
+  uint32_t start = ESP.getCycleCount();
+  uint32_t pos = mqttRingHead.load(std::memory_order_relaxed);
+  MqttSlot* slot;
+
+  while (true) {
+    slot = &mqttRing[pos & (MQTT_RING_SIZE - 1)];
+    uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0) {
+      if (mqttRingHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      mqttDropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = mqttRingHead.load(std::memory_order_relaxed);
+    }
+  }
+
+  if (len >= MQTT_SLOT_PAYLOAD_SIZE) {
+    len = MQTT_SLOT_PAYLOAD_SIZE - 1;
+    mqttTruncated.fetch_add(1, std::memory_order_relaxed);
+  }
+  memcpy(slot->payload, payload, len);
+  slot->payload[len] = '\0';
+  slot->len = len;
+  slot->topic = topic;
+  slot->retain = retain;
+  slot->queued_at = millis();
+  slot->sent = false;
+  slot->attempts = 0;
+  slot->seq.store(pos + 1, std::memory_order_release);
+
+  mqttEnqueued.fetch_add(1, std::memory_order_relaxed);
+  uint32_t cycles = ESP.getCycleCount() - start;
+  mqttEnqueueCycles.fetch_add(cycles, std::memory_order_relaxed);
+  mqttEnqueueSamples.fetch_add(1, std::memory_order_relaxed);
+  uint32_t prevMax = mqttEnqueueMaxCycles.load(std::memory_order_relaxed);
+  while (cycles > prevMax && !mqttEnqueueMaxCycles.compare_exchange_weak(prevMax, cycles, std::memory_order_relaxed)) {}
+  return true;
+}
+
+bool queueMqttMessage(MqttTopicId topic, const String& payload, bool retain) {
+  return queueMqttMessage(topic, payload.c_str(), payload.length(), retain);
+}
+
+// Consumer side: the committed slot `offset` places after the tail, or NULL
+MqttSlot* peekMqttSlot(uint32_t offset) {
+  uint32_t pos = mqttRingTail + offset;
+  MqttSlot* slot = &mqttRing[pos & (MQTT_RING_SIZE - 1)];
+  if (slot->seq.load(std::memory_order_acquire) != pos + 1) return NULL;
+  return slot;
+}
+
+void releaseMqttSlots(uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    mqttRing[mqttRingTail & (MQTT_RING_SIZE - 1)].seq.store(mqttRingTail + MQTT_RING_SIZE, std::memory_order_release);
+    mqttRingTail++;
+  }
+}
+
+int getMqttQueueSize() {
+  return (int)(mqttRingHead.load(std::memory_order_relaxed) - mqttRingTail);
+}
+
+void takeMqttRingStats(MqttQueueStats& st) {
+  st.enqueued = mqttEnqueued.load(std::memory_order_relaxed);
+  st.dropped = mqttDropped.load(std::memory_order_relaxed);
+  st.truncated = mqttTruncated.load(std::memory_order_relaxed);
+  uint32_t samples = mqttEnqueueSamples.exchange(0, std::memory_order_relaxed);
+  uint32_t cycles = mqttEnqueueCycles.exchange(0, std::memory_order_relaxed);
+  st.enqueue_avg_cycles = samples ? cycles / samples : 0;
+  st.enqueue_max_cycles = mqttEnqueueMaxCycles.exchange(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,36 @@
+#ifndef MQTT_RING_H
+#define MQTT_RING_H
+
+#include <atomic>
+#include "config.h"
+#include "types.h"
+
+// ---------- MQTT OUTBOUND RING ----------
+// Bounded multi-producer / single-consumer ring of fixed-size slots (Vyukov
+// sequence scheme). Producers claim a slot with one CAS and copy the payload
+// inline; they never block or allocate. networkTask is the only
+// consumer. When the ring is full the new message is dropped and counted.
+struct MqttSlot {
+  std::atomic<uint32_t> seq;
+  uint8_t topic;
+  bool retain;
+  uint16_t len;
+  uint32_t queued_at;  // millis() at enqueue, for flush latency
+  bool sent;           // consumer only: published, waiting for the slots before it
+  uint8_t attempts;    // consumer only: failed publishes while connected
+  char payload[MQTT_SLOT_PAYLOAD_SIZE];
+};
+
+void initMqttQueue();
+bool queueMqttMessage(MqttTopicId topic, const char* payload, size_t len, bool retain = false);
+bool queueMqttMessage(MqttTopicId topic, const String& payload, bool retain = false);
+int getMqttQueueSize();
+
+// Consumer side (networkTask only)
+MqttSlot* peekMqttSlot(uint32_t offset);
+void releaseMqttSlots(uint32_t count);
+
+// Producer-side counters; enqueue cost covers the time since the last call
+void takeMqttRingStats(MqttQueueStats& st);
+
+#endif
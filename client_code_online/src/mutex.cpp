@@ -1,5 +1,6 @@
 #include "mutex.h"
-#include "mqtt.h"
+#include "errors.h"
+#include "network.h"
 #include "config.h"
 
 // ---------- MUTEX MANAGEMENT ----------
@@ -21,8 +22,12 @@ void unlockBusy() {
 
 void checkDeadlock() {
     if (busyLockedAt > 0 && millis() - busyLockedAt > DEADLOCK_TIMEOUT) {
-        mqttPublishError("deadlock_detected_rebooting");
-        ESP.restart();
+        reportError(ERR_SYS_DEADLOCK);
+        // networkTask flushes the error out before restarting
+        if (!netPost(NET_CMD_REBOOT)) {
+            ESP.restart();
+        }
+        busyLockedAt = 0;
     }
 }
 
@@ -1,7 +1,10 @@
 #include "network.h"
 #include "mqtt.h"
+#include "errors.h"
 #include "display.h"
 #include "api.h"
+#include "tasks.h"
+#include "http_stream.h"
 
 // ---------- GLOBAL NETWORK OBJECTS ----------
 WiFiClient net;
@@ -9,42 +12,74 @@ PubSubClient mqtt(net);
 String topic_errors = String("bakery/") + bakery_id + "/error";
 String topic_bread_time = String("bakery/") + bakery_id + "/bread_time_update";
 String topic_customer_queue  = String("bakery/") + bakery_id + "/has_customer_in_queue_update";
+String topic_stats = String("bakery/") + bakery_id + "/stats";
+String topic_current_ticket = String("bakery/") + bakery_id + "/current_ticket_update";
+String topic_wait_list = String("bakery/") + bakery_id + "/wait_list_update";
 // String topic_upcoming_queue  = String("bakery/") + bakery_id + "/has_upcoming_customer_in_queue_update";
 
 
 // ---------- NETWORK STATE MANAGEMENT ----------
-SemaphoreHandle_t networkBlockMutex;
-bool networkBlock = false;
 unsigned long lastWifiAttempt = 0;
 unsigned long lastMqttAttempt = 0;
 
-void setNetworkBlock(bool enable) {
-  if (enable && !networkBlock) {
-    xSemaphoreTake(networkBlockMutex, portMAX_DELAY);
-    networkBlock = true;
-  } else if (!enable && networkBlock) {
-    xSemaphoreGive(networkBlockMutex);
-    networkBlock = false;
+// Link state as event group bits. WIFI_UP, MQTT_UP and API_ALLOWED are
+// written only by networkTask, so other tasks never have to touch the (non
+// thread-safe) PubSubClient; INIT_DONE by fetchInitTask. Waiters wake on the
+// transition itself instead of polling.
+static EventGroupHandle_t netEvents = NULL;
+static uint32_t netTransitions = 0;
+
+static void setNetBit(EventBits_t bit, bool on) {
+  if (!netEvents) return;
+  bool was = (xEventGroupGetBits(netEvents) & bit) != 0;
+  if (was == on) return;
+  netTransitions++;
+  if (on) {
+    xEventGroupSetBits(netEvents, bit);
+  } else {
+    xEventGroupClearBits(netEvents, bit);
   }
 }
 
-bool isNetworkBlocked() {
-  if (xSemaphoreTake(networkBlockMutex, (TickType_t)0) == pdTRUE) {
-    xSemaphoreGive(networkBlockMutex);
-    return false;
-  }
-  return true;
+bool netWaitFor(EventBits_t bits, TickType_t wait) {
+  if (!netEvents) return false;
+  return (xEventGroupWaitBits(netEvents, bits, pdFALSE, pdTRUE, wait) & bits) == bits;
+}
+
+EventBits_t netGetBits() {
+  return netEvents ? xEventGroupGetBits(netEvents) : 0;
+}
+
+uint32_t getNetTransitionCount() {
+  return netTransitions;
+}
+
+void setInitDone(bool done) {
+  setNetBit(NET_BIT_INIT_DONE, done);
+}
+
+bool isInitDone() {
+  return (netGetBits() & NET_BIT_INIT_DONE) != 0;
 }
 
 bool isNetworkReadyForApi() {
-  return WiFi.status() == WL_CONNECTED && mqtt.connected() && !isNetworkBlocked();
+  return (netGetBits() & NET_API_BITS) == NET_API_BITS;
 }
 
 bool isNetworkReady() {
-  return WiFi.status() == WL_CONNECTED && mqtt.connected();
+  return (netGetBits() & NET_READY_BITS) == NET_READY_BITS;
+}
+
+// While a warm start runs on cached config the counter stays usable, so
+// link progress is kept off the display until the first sync. An order left
+// waiting too long for the API shows the waiting pattern (orderWorkerTask).
+static void setLinkStatus(DeviceStatus st) {
+  if (isWarmStartSyncPending()) return;
+  setStatus(st);
 }
 
-void ensureConnectivity() {
+// Runs on networkTask only
+static void ensureConnectivity() {
 
   if (millis() - lastConnectivityCheck < CONNECTIVITY_CHECK_INTERVAL) {
       return;
@@ -53,8 +88,8 @@ void ensureConnectivity() {
 
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("trying to connect to wifi...");
-    setStatus(STATUS_WIFI_CONNECTING);
-    setNetworkBlock(true);
+    setLinkStatus(STATUS_WIFI_CONNECTING);
+    setNetBit(NET_BIT_API_ALLOWED, false);
     if (millis() - lastWifiAttempt > WIFI_RECONNECT_INTERVAL) {
       lastWifiAttempt = millis();
       WiFi.disconnect();
@@ -65,69 +100,304 @@ void ensureConnectivity() {
       if (millis() - lastMqttAttempt > MQTT_RECONNECT_INTERVAL) {
         Serial.println("trying to connect to mqtt server...");
         lastMqttAttempt = millis();
-        setStatus(STATUS_MQTT_CONNECTING);
+        setLinkStatus(STATUS_MQTT_CONNECTING);
         if (mqtt.connect(bakery_id)) {
           mqtt.subscribe(topic_bread_time.c_str());
           mqtt.subscribe(topic_customer_queue.c_str());
+          mqtt.subscribe(topic_current_ticket.c_str());
+          mqtt.subscribe(topic_wait_list.c_str());
           // mqtt.subscribe(topic_upcoming_queue.c_str());
           // If init has not completed yet, stay in INIT visual state (C3 pattern)
-          if (!init_success) {
+          if (!isInitDone()) {
             setStatus(STATUS_INIT);
           } else {
             setStatus(STATUS_NORMAL);
           }
         } else {
-          setNetworkBlock(true);
-          setStatus(STATUS_MQTT_ERROR);
+          setNetBit(NET_BIT_API_ALLOWED, false);
+          setLinkStatus(STATUS_MQTT_ERROR);
         }
       }
     } else {
-      setNetworkBlock(false);
+      setNetBit(NET_BIT_API_ALLOWED, true);
       if (currentStatus == STATUS_WIFI_ERROR || currentStatus == STATUS_MQTT_ERROR) {
       setStatus(STATUS_NORMAL);
       }
+    }
+  }
+
+}
+
+// ---------- NETWORK OWNER TASK ----------
+// networkTask is the only code that touches WiFi, PubSubClient and its
+// WiFiClient: connect/reconnect, mqtt.loop() (and so mqttCallback), and
+// flushing the outbound MQTT ring. Other tasks publish through the ring and
+// ask for anything else with netPost(); both are picked up within one
+// NETWORK_TASK_TICK_MS tick.
+static QueueHandle_t netCommandQueue = NULL;
+
+void initNetwork() {
+  netEvents = xEventGroupCreate();
+  netCommandQueue = xQueueCreate(NET_COMMAND_QUEUE_DEPTH, sizeof(NetCommand));
+
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, password);
+
+  mqtt.setServer(mqtt_server, mqtt_port);
+  mqtt.setBufferSize(MQTT_BUFFER_SIZE);
+  mqtt.setCallback(mqttCallback);
+}
+
+bool netPost(NetCommandType type) {
+  if (!netCommandQueue) return false;
+  NetCommand cmd;
+  cmd.type = type;
+  return xQueueSend(netCommandQueue, &cmd, (TickType_t)0) == pdTRUE;
+}
+
+static void handleNetCommand(const NetCommand& cmd) {
+  switch (cmd.type) {
+    case NET_CMD_FLUSH:
+      mqttOutboundTick(true);
+      break;
+    case NET_CMD_RECONNECT_MQTT:
+      mqtt.disconnect();
+      setNetBit(NET_BIT_MQTT_UP, false);
+      lastMqttAttempt = 0;
+      lastConnectivityCheck = 0;
+      break;
+    case NET_CMD_REBOOT:
+      // Give queued errors one last chance to reach the broker
+      if (mqtt.connected()) {
+        mqttOutboundTick(true);
+        mqtt.loop();
+        delay(200);
+      }
+      ESP.restart();
+      break;
+  }
+}
+
+void networkTask(void* param) {
+  NetCommand cmd;
+
+  while (true) {
+    if (xQueueReceive(netCommandQueue, &cmd, NETWORK_TASK_TICK_MS / portTICK_PERIOD_MS) == pdTRUE) {
+      handleNetCommand(cmd);
+    }
+
+    ensureConnectivity();
+    bool wifiUp = WiFi.status() == WL_CONNECTED;
+    setNetBit(NET_BIT_WIFI_UP, wifiUp);
+
+    if (wifiUp && mqtt.connected()) {
       mqtt.loop();
+      mqttOutboundTick(false);
     }
+    setNetBit(NET_BIT_MQTT_UP, wifiUp && mqtt.connected());
   }
+}
+
+// ---------- HTTP SESSION POOL ----------
+// Each session owns a WiFiClient that outlives the request, so HTTPClient can
+// keep the socket to endpoint_address open between calls (keep-alive).
+struct HttpSession {
+  WiFiClient client;
+  HTTPClient http;
+  SemaphoreHandle_t lock = NULL;
+  unsigned long lastUsed = 0;
+};
 
+static HttpSession httpSessions[HTTP_SESSION_POOL_SIZE];
+static HttpSessionStats httpStats;
+static portMUX_TYPE httpStatsMux = portMUX_INITIALIZER_UNLOCKED;
+
+void initHttpSessions() {
+  for (int i = 0; i < HTTP_SESSION_POOL_SIZE; i++) {
+    httpSessions[i].lock = xSemaphoreCreateMutex();
+    httpSessions[i].http.setReuse(true);
+  }
 }
 
-HttpResponse sendHttpRequest(const String& url, const char* method, const String& body, uint16_t timeoutMs, uint8_t maxRetries) {
-  HttpResponse resp = {-1, ""};
+// Prefer a free session that still holds an open socket, then any free one,
+// and only block when every session is busy.
+static HttpSession* acquireHttpSession(uint32_t timeoutMs) {
+  HttpSession* fallback = NULL;
+  for (int i = 0; i < HTTP_SESSION_POOL_SIZE; i++) {
+    if (xSemaphoreTake(httpSessions[i].lock, (TickType_t)0) == pdTRUE) {
+      if (httpSessions[i].client.connected()) {
+        if (fallback) xSemaphoreGive(fallback->lock);
+        return &httpSessions[i];
+      }
+      if (!fallback) {
+        fallback = &httpSessions[i];
+      } else {
+        xSemaphoreGive(httpSessions[i].lock);
+      }
+    }
+  }
+  if (fallback) return fallback;
 
-  if (WiFi.status() != WL_CONNECTED) return resp;
+  if (xSemaphoreTake(httpSessions[0].lock, timeoutMs / portTICK_PERIOD_MS) == pdTRUE) {
+    return &httpSessions[0];
+  }
+  return NULL;
+}
+
+static void releaseHttpSession(HttpSession* session) {
+  session->lastUsed = millis();
+  xSemaphoreGive(session->lock);
+}
+
+// Drop sockets the server has (or is about to have) closed so the next
+// request opens a fresh one instead of failing on a dead connection.
+static bool sessionHasLiveSocket(HttpSession* session) {
+  if (!session->client.connected()) return false;
+  if (millis() - session->lastUsed > HTTP_SESSION_IDLE_TIMEOUT) {
+    session->client.stop();
+    return false;
+  }
+  return true;
+}
+
+// Where a response body goes: copied into a String, or streamed into a
+// JsonDocument (optionally through a filter). heapUsed is the heap the
+// request was holding at parse time, relative to when it started.
+struct HttpBodyTarget {
+  String* text = NULL;
+  JsonDocument* doc = NULL;
+  const JsonDocument* filter = NULL;
+  DeserializationError error;
+  uint32_t heapBefore = 0;
+  uint32_t heapUsed = 0;
+};
+
+static const char* transferEncodingHeader[] = { "Transfer-Encoding" };
+
+static int performHttpRequest(HttpSession* session, const String& url, const char* method, const String& body, uint16_t timeoutMs, HttpBodyTarget& target) {
+  HTTPClient& http = session->http;
+  http.begin(session->client, url);
+  http.addHeader("authorization", "Bearer " + String(token));
+  http.setTimeout(timeoutMs);
+  if (!target.text) {
+    http.collectHeaders(transferEncodingHeader, 1);
+  }
+
+  int code = -1;
+  if      (!strcmp(method, "GET"))  code = http.GET();
+  else if (!strcmp(method, "POST")) code = http.POST(body);
+  else if (!strcmp(method, "PUT"))  code = http.PUT(body);
+
+  if (code > 0 && code < 500) {
+    if (target.text) {
+      *target.text = http.getString();
+    } else {
+      bool chunked = http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+      HttpBodyStream stream(session->client, http.getSize(), chunked);
+      if (code == 200 && target.doc) {
+        if (target.filter) {
+          target.error = deserializeJson(*target.doc, stream, DeserializationOption::Filter(*target.filter));
+        } else {
+          target.error = deserializeJson(*target.doc, stream);
+        }
+        uint32_t heapNow = ESP.getFreeHeap();
+        target.heapUsed = target.heapBefore > heapNow ? target.heapBefore - heapNow : 0;
+      }
+      stream.drain();
+    }
+  }
+
+  // end() keeps the socket open when the server agreed to keep-alive
+  http.end();
+  return code;
+}
+
+HttpSessionStats getHttpSessionStats() {
+  portENTER_CRITICAL(&httpStatsMux);
+  HttpSessionStats s = httpStats;
+  portEXIT_CRITICAL(&httpStatsMux);
+  return s;
+}
+
+// Re-sending for free is only safe when the request cannot have been acted
+// on: the headers never went out, or it is a GET. A connection lost after a
+// POST was written may already have issued a ticket, so that takes the
+// normal error path.
+static bool isStaleSocketError(int code, const char* method) {
+  if (code == HTTPC_ERROR_SEND_HEADER_FAILED) return true;
+  return code == HTTPC_ERROR_CONNECTION_LOST && strcmp(method, "GET") == 0;
+}
+
+static int runHttpRequest(const String& url, const char* method, const String& body, uint16_t timeoutMs, uint8_t maxRetries, HttpBodyTarget& target) {
+  if (WiFi.status() != WL_CONNECTED) return -1;
+
+  target.heapBefore = ESP.getFreeHeap();
+
+  HttpSession* session = acquireHttpSession(timeoutMs);
+  if (!session) {
+    reportError(ERR_NET_NO_HTTP_SESSION);
+    return -1;
+  }
 
   int lastCode = -1;
 
   for (uint8_t attempt = 0; attempt < maxRetries; ++attempt) {
-    HTTPClient http;
-    http.begin(url);
-    http.addHeader("authorization", "Bearer " + String(token));
-    http.addHeader("Connection", "keep-alive");
-    http.setTimeout(timeoutMs);
-
-    int code = -1;
-    if      (!strcmp(method, "GET"))  code = http.GET();
-    else if (!strcmp(method, "POST")) code = http.POST(body);
-    else if (!strcmp(method, "PUT"))  code = http.PUT(body);
-
-    resp.status_code = code;
+    bool reused = sessionHasLiveSocket(session);
+    bool reconnected = false;
+
+    int code = performHttpRequest(session, url, method, body, timeoutMs, target);
+
+    // A reused socket that fails this way was most likely closed by the
+    // server while idle: reconnect once without spending a retry.
+    if (reused && isStaleSocketError(code, method)) {
+      session->client.stop();
+      code = performHttpRequest(session, url, method, body, timeoutMs, target);
+      reused = false;
+      reconnected = true;
+    }
+
+    portENTER_CRITICAL(&httpStatsMux);
+    httpStats.requests++;
+    if (reconnected) httpStats.reconnects++;
+    if (reused) httpStats.reused++;
+    portEXIT_CRITICAL(&httpStatsMux);
+
     lastCode = code;
 
     if (code > 0 && code < 500) {
-      resp.body = http.getString();
-      http.end();
-      return resp;
+      releaseHttpSession(session);
+      return code;
     }
 
-    http.end();
+    session->client.stop();
 
     if (attempt + 1 < maxRetries) {
       delay(HTTP_RETRY_DELAY);
     }
   }
 
-  mqttPublishError("network:sendHttpRequest:failed after retries with status code: " + String(lastCode) + " | URL: " + String(url));
+  releaseHttpSession(session);
+
+  reportError(ERR_NET_HTTP_RETRIES, lastCode);
+
+  return lastCode;
+}
+
+HttpResponse sendHttpRequest(const String& url, const char* method, const String& body, uint16_t timeoutMs, uint8_t maxRetries) {
+  HttpResponse resp = {-1, ""};
+  HttpBodyTarget target;
+  target.text = &resp.body;
+  resp.status_code = runHttpRequest(url, method, body, timeoutMs, maxRetries, target);
+  return resp;
+}
 
+HttpJsonResponse sendHttpRequestJson(const String& url, const char* method, const String& body, JsonDocument* doc, const JsonDocument* filter, uint16_t timeoutMs, uint8_t maxRetries) {
+  HttpJsonResponse resp;
+  HttpBodyTarget target;
+  target.doc = doc;
+  target.filter = filter;
+  resp.status_code = runHttpRequest(url, method, body, timeoutMs, maxRetries, target);
+  resp.error = target.error;
+  resp.heap_used = target.heapUsed;
   return resp;
 }
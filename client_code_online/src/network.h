@@ -4,6 +4,7 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <HTTPClient.h>
+#include <ArduinoJson.h>
 #include "config.h"
 #include "types.h"
 
@@ -13,22 +14,51 @@ extern PubSubClient mqtt;
 extern String topic_errors;
 extern String topic_bread_time;
 extern String topic_customer_queue;
+extern String topic_stats;
+extern String topic_current_ticket;
+extern String topic_wait_list;
 // extern String topic_upcoming_queue;
 
 
 // ---------- NETWORK STATE MANAGEMENT ----------
-extern SemaphoreHandle_t networkBlockMutex;
-extern bool networkBlock;
+// Connectivity bits; tasks block on the ones they need with netWaitFor()
+#define NET_BIT_WIFI_UP      BIT0
+#define NET_BIT_MQTT_UP      BIT1
+#define NET_BIT_INIT_DONE    BIT2   // fetchInitTask finished
+#define NET_BIT_API_ALLOWED  BIT3   // broker session established, HTTP calls allowed
+#define NET_READY_BITS       (NET_BIT_WIFI_UP | NET_BIT_MQTT_UP)
+#define NET_API_BITS         (NET_READY_BITS | NET_BIT_API_ALLOWED)
+
 extern unsigned long lastWifiAttempt;
 extern unsigned long lastMqttAttempt;
 
-void setNetworkBlock(bool enable);
-bool isNetworkBlocked();
+bool netWaitFor(EventBits_t bits, TickType_t wait);  // true once all of `bits` are set
+EventBits_t netGetBits();
+uint32_t getNetTransitionCount();
+void setInitDone(bool done);
+bool isInitDone();
 bool isNetworkReadyForApi();
 bool isNetworkReady();
-void ensureConnectivity();
+
+// ---------- NETWORK OWNER TASK ----------
+void initNetwork();
+bool netPost(NetCommandType type);
+void networkTask(void* param);
 
 // ---------- HTTP FUNCTIONS ----------
+void initHttpSessions();
+HttpSessionStats getHttpSessionStats();
 HttpResponse sendHttpRequest(const String& url, const char* method, const String& body = "", uint16_t timeoutMs = HTTP_TIMEOUT, uint8_t maxRetries = MAX_HTTP_RETRIES);
 
+struct HttpJsonResponse {
+  int status_code = -1;
+  DeserializationError error;  // only meaningful when status_code == 200
+  uint32_t heap_used = 0;      // heap held by the request at parse time
+};
+
+// Parses a 200 response body straight from the socket into `doc`, keeping
+// only what `filter` selects (NULL keeps everything). With doc == NULL the
+// body is read and discarded. Error bodies are never buffered.
+HttpJsonResponse sendHttpRequestJson(const String& url, const char* method, const String& body, JsonDocument* doc, const JsonDocument* filter, uint16_t timeoutMs = HTTP_TIMEOUT, uint8_t maxRetries = MAX_HTTP_RETRIES);
+
 #endif
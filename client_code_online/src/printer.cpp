@@ -0,0 +1,193 @@
+#include "printer.h"
+#include "errors.h"
+#include <HardwareSerial.h>
+#include <atomic>
+
+// -----------------------------
+// CSN-A2 Printer (UART) Templates
+// -----------------------------
+// A ticket is fixed ESC/POS byte runs with three patch points: the ticket
+// id, the QR store length and the reservation URL. Each job is rendered
+// into printerBuf and handed to the UART in a single write.
+
+static const uint8_t resetPrinter[] = { 27, 64 };  // ESC @ - reset
+
+// Everything before the ticket id
+static const uint8_t ticketHeader[] = {
+  27, 97, 1,                                          // ESC a 1 - center alignment
+  29, 33, 0x00,                                       // GS ! 0 - normal size
+  'C', 'u', 's', 't', 'o', 'm', 'e', 'r', ' ', 'I', 'D', '\r', '\n',
+  10,                                                 // LF
+  27, 69, 1,                                          // ESC E 1 - bold on
+  29, 33, 0x11                                        // GS ! 0x11 - double width & height
+};
+
+// [ticket id] then up to the QR data
+static const uint8_t ticketAfterId[] = {
+  '\r', '\n',
+  27, 69, 0,                                          // ESC E 0 - bold off
+  29, 33, 0x00,                                       // GS ! 0 - normal size
+  27, 100, 2,                                         // ESC d 2 - print and feed 2 lines
+  0x1D, 0x28, 0x6B, 0x04, 0x00, 0x31, 0x41, 0x32, 0x00,  // QR model 2
+  0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x43, 0x06,        // QR size 6
+  0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x45, 0x31,        // QR error level M
+  0x1D, 0x28, 0x6B, 0x00, 0x00, 0x31, 0x50, 0x30         // QR store, pL/pH patched
+};
+#define QR_STORE_PL_OFFSET (sizeof(ticketAfterId) - 5)
+
+// [reservation URL] then the rest
+static const uint8_t ticketAfterUrl[] = {
+  0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x51, 0x30,        // QR print
+  10,                                                 // LF - one line gap
+  27, 100, 3                                          // ESC d 3 - feed so the ticket can be torn
+};
+
+static const uint8_t ticketVoid[] = {
+  27, 69, 0,                                          // ESC E 0 - bold off
+  29, 33, 0x00,                                       // GS ! 0 - normal size
+  '-', '-', ' ', 'N', 'O', 'T', ' ', 'I', 'S', 'S', 'U', 'E', 'D', ' ', '-', '-', '\r', '\n',
+  27, 100, 3                                          // ESC d 3
+};
+
+static_assert(sizeof(ticketHeader) + 16 + sizeof(ticketAfterId) + 96 + sizeof(ticketAfterUrl) <= PRINTER_BUFFER_SIZE,
+              "PRINTER_BUFFER_SIZE too small for a full ticket");
+
+HardwareSerial printerSerial(1);
+
+static QueueHandle_t printerQueue = NULL;
+static uint8_t printerBuf[PRINTER_BUFFER_SIZE];
+static portMUX_TYPE printerStatsMux = portMUX_INITIALIZER_UNLOCKED;
+static PrinterStats printerStats;
+// Begun tickets whose FINISH or VOID is not queued yet. Each one holds a
+// queue slot, so a printed header is never left without its ending.
+static std::atomic<int> printerReserved(0);
+
+// ---------- RENDERING ----------
+static size_t append(size_t n, const uint8_t* bytes, size_t len) {
+  memcpy(printerBuf + n, bytes, len);
+  return n + len;
+}
+
+static size_t renderTicketBody(size_t n, int bakeryId, int ticketId) {
+  // Big bold ticket ID
+  n += snprintf((char*)printerBuf + n, 16, "%d", ticketId);
+
+  size_t storeAt = n;
+  n = append(n, ticketAfterId, sizeof(ticketAfterId));
+
+  // QR code with reservation URL
+  int urlLen = snprintf((char*)printerBuf + n, 96, "https://noonyar.ir/res/?b=%d&t=%d", bakeryId, ticketId);
+  printerBuf[storeAt + QR_STORE_PL_OFFSET] = (uint8_t)((urlLen + 3) % 256);
+  printerBuf[storeAt + QR_STORE_PL_OFFSET + 1] = (uint8_t)((urlLen + 3) / 256);
+  n += urlLen;
+
+  return append(n, ticketAfterUrl, sizeof(ticketAfterUrl));
+}
+
+static size_t renderJob(const PrinterJob& job) {
+  size_t n = 0;
+  switch (job.type) {
+    case PRINTER_JOB_BEGIN:
+      n = append(n, ticketHeader, sizeof(ticketHeader));
+      break;
+    case PRINTER_JOB_FINISH:
+      n = renderTicketBody(n, job.bakery_id, job.ticket_id);
+      break;
+    case PRINTER_JOB_TICKET:
+      n = append(n, ticketHeader, sizeof(ticketHeader));
+      n = renderTicketBody(n, job.bakery_id, job.ticket_id);
+      break;
+    case PRINTER_JOB_VOID:
+      n = append(n, ticketVoid, sizeof(ticketVoid));
+      break;
+  }
+  return n;
+}
+
+// ---------- PRINTER TASK ----------
+void initPrinter() {
+  printerQueue = xQueueCreate(PRINTER_QUEUE_DEPTH, sizeof(PrinterJob));
+}
+
+void printerTask(void* param) {
+  printerSerial.begin(PRINTER_BAUD, SERIAL_8N1, RXD2, TXD2);
+  vTaskDelay(100 / portTICK_PERIOD_MS);
+  printerSerial.write(resetPrinter, sizeof(resetPrinter));
+
+  PrinterJob job;
+  while (true) {
+    if (xQueueReceive(printerQueue, &job, portMAX_DELAY) != pdTRUE) continue;
+
+    size_t n = renderJob(job);
+    unsigned long start = millis();
+    printerSerial.write(printerBuf, n);
+    // Wait for the bytes to leave so busy_ms is the real cost of the job
+    printerSerial.flush();
+    unsigned long took = millis() - start;
+
+    portENTER_CRITICAL(&printerStatsMux);
+    printerStats.bytes += n;
+    printerStats.busy_ms += took;
+    if (job.type == PRINTER_JOB_FINISH || job.type == PRINTER_JOB_TICKET) printerStats.tickets++;
+    if (job.type == PRINTER_JOB_VOID) printerStats.voided++;
+    portEXIT_CRITICAL(&printerStatsMux);
+  }
+}
+
+// `slots` is how many free queue slots the job needs beyond the reserved
+// ones: 2 for a header (itself and its ending), 1 for a whole ticket, 0 for
+// the ending of a begun ticket, which uses its reservation
+static bool printerSubmit(PrinterJobType type, int bakeryId, int ticketId, int slots, TickType_t wait = 0) {
+  if (!printerQueue) return false;
+  PrinterJob job;
+  job.type = type;
+  job.bakery_id = bakeryId;
+  job.ticket_id = ticketId;
+
+  bool fits = slots == 0 || (int)uxQueueSpacesAvailable(printerQueue) >= printerReserved.load() + slots;
+  if (fits && xQueueSend(printerQueue, &job, wait) == pdTRUE) return true;
+
+  portENTER_CRITICAL(&printerStatsMux);
+  printerStats.dropped++;
+  portEXIT_CRITICAL(&printerStatsMux);
+  return false;
+}
+
+bool printerBeginTicket() {
+  if (!printerSubmit(PRINTER_JOB_BEGIN, 0, -1, 2)) return false;
+  printerReserved++;
+  return true;
+}
+
+// Ends a begun ticket with `type`; if even the reserved slot is gone, a VOID
+// still gets PRINTER_CLOSE_WAIT_MS to close the header
+static bool printerCloseTicket(PrinterJobType type, int bakeryId, int ticketId) {
+  TickType_t wait = PRINTER_CLOSE_WAIT_MS / portTICK_PERIOD_MS;
+  bool ok = printerSubmit(type, bakeryId, ticketId, 0, wait);
+  if (!ok) {
+    reportError(ERR_PRINTER_FINISH_DROPPED, ticketId);
+    if (type != PRINTER_JOB_VOID) printerSubmit(PRINTER_JOB_VOID, 0, -1, 0, wait);
+  }
+  printerReserved--;
+  return ok;
+}
+
+// Without a begun header the whole ticket is printed
+bool printerFinishTicket(int bakeryId, int ticketId, bool begun) {
+  if (!begun) return printerSubmit(PRINTER_JOB_TICKET, bakeryId, ticketId, 1);
+  return printerCloseTicket(PRINTER_JOB_FINISH, bakeryId, ticketId);
+}
+
+bool printerVoidTicket() {
+  return printerCloseTicket(PRINTER_JOB_VOID, 0, -1);
+}
+
+PrinterStats getPrinterStats() {
+  portENTER_CRITICAL(&printerStatsMux);
+  PrinterStats st = printerStats;
+  printerStats = PrinterStats();
+  portEXIT_CRITICAL(&printerStatsMux);
+
+  st.capacity_tpm = st.busy_ms ? (uint32_t)((uint64_t)st.tickets * 60000 / st.busy_ms) : 0;
+  return st;
+}
@@ -0,0 +1,20 @@
+#ifndef PRINTER_H
+#define PRINTER_H
+
+#include "config.h"
+#include "types.h"
+
+// ---------- PRINTER ----------
+// printerTask owns the CSN-A2 UART. Callers only queue jobs, so a slow or
+// stuck printer never holds up order submission; a full queue drops the job.
+// A begun ticket keeps a slot for its FINISH or VOID, so only new tickets
+// are ever dropped, never the ending of a header already on paper.
+void initPrinter();
+void printerTask(void* param);
+
+bool printerBeginTicket();
+bool printerFinishTicket(int bakeryId, int ticketId, bool begun);
+bool printerVoidTicket();
+PrinterStats getPrinterStats();
+
+#endif
@@ -0,0 +1,237 @@
+#include "scanner.h"
+#include <esp_timer.h>
+
+static QueueHandle_t scanQueue = NULL;
+
+// Framing state, only touched from the UART receive callback
+static char scanLine[SCANNER_LINE_MAX];
+static size_t scanLen = 0;
+static bool scanOverflow = false;
+static uint32_t scanStartUs = 0;
+
+// Written from the UART event task and scannerTask, read by networkTask
+static portMUX_TYPE scanStatsMux = portMUX_INITIALIZER_UNLOCKED;
+static ScannerStats scanStats;
+static uint32_t scanSubmits = 0;
+static uint64_t scanSubmitSum = 0;
+static uint64_t scanResultSum = 0;
+
+// ---------- QR PARSER ----------
+// Codes look like https://noonyar.ir/res/?b=<bakery>&t=<ticket>. Walks the
+// key=value pairs after '?' (or the whole line for bare "t=..." codes) in
+// place; no String, no heap.
+
+// Parses [p, end) as a non-negative decimal, -1 if empty or not a number
+static long parseDecimal(const char* p, const char* end) {
+  if (p == end) return -1;
+  long v = 0;
+  for (; p < end; p++) {
+    if (*p < '0' || *p > '9') return -1;
+    v = v * 10 + (*p - '0');
+    if (v > 1000000000L) return -1;
+  }
+  return v;
+}
+
+static bool spanEquals(const char* p, const char* end, const char* s) {
+  size_t n = strlen(s);
+  return (size_t)(end - p) == n && memcmp(p, s, n) == 0;
+}
+
+enum ScanParse : uint8_t {
+  SCAN_OK,
+  SCAN_MALFORMED,
+  SCAN_OTHER_BAKERY
+};
+
+static ScanParse parseScanLine(const char* line, size_t len, int& ticketId) {
+  const char* end = line + len;
+  const char* p = (const char*)memchr(line, '?', len);
+  p = p ? p + 1 : line;
+
+  long ticket = -1;
+  bool bakeryMatches = true;   // codes without b= predate multi-bakery links
+
+  while (p < end) {
+    const char* amp = (const char*)memchr(p, '&', end - p);
+    const char* pairEnd = amp ? amp : end;
+    const char* eq = (const char*)memchr(p, '=', pairEnd - p);
+    if (eq) {
+      if (spanEquals(p, eq, "t")) {
+        ticket = parseDecimal(eq + 1, pairEnd);
+      } else if (spanEquals(p, eq, "b")) {
+        bakeryMatches = spanEquals(eq + 1, pairEnd, bakery_id);
+      }
+    }
+    p = pairEnd + 1;
+  }
+
+  if (ticket < 0) return SCAN_MALFORMED;
+  if (!bakeryMatches) return SCAN_OTHER_BAKERY;
+  ticketId = (int)ticket;
+  return SCAN_OK;
+}
+
+static void finishLine() {
+  if (scanLen == 0 && !scanOverflow) return;
+
+  int ticketId = -1;
+  ScanParse result = scanOverflow ? SCAN_MALFORMED : parseScanLine(scanLine, scanLen, ticketId);
+
+  bool queued = false;
+  if (result == SCAN_OK) {
+    ScanTicket scan;
+    scan.ticket_id = ticketId;
+    scan.rx_us = scanStartUs;
+    queued = xQueueSend(scanQueue, &scan, (TickType_t)0) == pdTRUE;
+  }
+
+  portENTER_CRITICAL(&scanStatsMux);
+  if (result == SCAN_OK) {
+    if (queued) scanStats.scans++;
+    else scanStats.dropped++;
+  } else if (result == SCAN_OTHER_BAKERY) {
+    scanStats.other_bakery++;
+  } else {
+    scanStats.malformed++;
+  }
+  portEXIT_CRITICAL(&scanStatsMux);
+
+  if (result == SCAN_OTHER_BAKERY) Serial.println("Scan rejected: ticket for another bakery");
+
+  scanLen = 0;
+  scanOverflow = false;
+}
+
+// ---------- UART RECEIVE ----------
+// Runs on the UART event task once the line has been idle for
+// SCANNER_RX_TIMEOUT byte times, i.e. after the scanner finished sending.
+// CR/LF split codes sent back to back; whatever is left when the line goes
+// idle is a code sent without a terminator (or a garbled tail) and is
+// finished here, never carried over into the next scan.
+static void scannerOnReceive() {
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c < 0) break;
+
+    if (c == '\n' || c == '\r') {
+      finishLine();
+      continue;
+    }
+    if (scanLen == 0 && !scanOverflow) {
+      scanStartUs = (uint32_t)esp_timer_get_time();
+    }
+    if (scanLen < sizeof(scanLine)) {
+      scanLine[scanLen++] = (char)c;
+    } else {
+      scanOverflow = true;
+    }
+  }
+  finishLine();
+}
+
+void initScanner() {
+  scanQueue = xQueueCreate(SCANNER_QUEUE_DEPTH, sizeof(ScanTicket));
+  Serial.setRxTimeout(SCANNER_RX_TIMEOUT);
+  Serial.onReceive(scannerOnReceive, true);
+}
+
+bool scannerNextTicket(ScanTicket& scan, TickType_t wait) {
+  if (!scanQueue) return false;
+  return xQueueReceive(scanQueue, &scan, wait) == pdTRUE;
+}
+
+// ---------- RECENT TICKETS ----------
+// Customers wave the same code several times. The server's answer for a
+// ticket is kept for a while (LRU, per-verdict TTL) so repeats are answered
+// without another serve request.
+struct TicketCacheEntry {
+  int ticket_id = -1;
+  TicketVerdict verdict = TICKET_UNKNOWN;
+  unsigned long expires = 0;
+  unsigned long lastUsed = 0;
+};
+
+static TicketCacheEntry ticketCache[TICKET_CACHE_SIZE];
+
+static bool ticketEntryLive(const TicketCacheEntry& e, unsigned long now) {
+  return e.verdict != TICKET_UNKNOWN && (long)(e.expires - now) > 0;
+}
+
+TicketVerdict scannerLookupTicket(int ticketId) {
+  unsigned long now = millis();
+  for (int i = 0; i < TICKET_CACHE_SIZE; i++) {
+    TicketCacheEntry& e = ticketCache[i];
+    if (e.ticket_id == ticketId && ticketEntryLive(e, now)) {
+      e.lastUsed = now;
+      portENTER_CRITICAL(&scanStatsMux);
+      scanStats.cache_hits++;
+      portEXIT_CRITICAL(&scanStatsMux);
+      return e.verdict;
+    }
+  }
+  portENTER_CRITICAL(&scanStatsMux);
+  scanStats.cache_misses++;
+  portEXIT_CRITICAL(&scanStatsMux);
+  return TICKET_UNKNOWN;
+}
+
+void scannerRememberTicket(int ticketId, TicketVerdict verdict) {
+  unsigned long now = millis();
+  TicketCacheEntry* slot = NULL;
+
+  // Same ticket, else a free or expired slot, else the least recently used
+  for (int i = 0; i < TICKET_CACHE_SIZE && !slot; i++) {
+    if (ticketCache[i].ticket_id == ticketId) slot = &ticketCache[i];
+  }
+  for (int i = 0; i < TICKET_CACHE_SIZE && !slot; i++) {
+    if (!ticketEntryLive(ticketCache[i], now)) slot = &ticketCache[i];
+  }
+  if (!slot) {
+    slot = &ticketCache[0];
+    for (int i = 1; i < TICKET_CACHE_SIZE; i++) {
+      if ((long)(ticketCache[i].lastUsed - slot->lastUsed) < 0) slot = &ticketCache[i];
+    }
+  }
+
+  slot->ticket_id = ticketId;
+  slot->verdict = verdict;
+  slot->lastUsed = now;
+  slot->expires = now + (verdict == TICKET_SERVED ? TICKET_SERVED_TTL_MS : TICKET_REJECTED_TTL_MS);
+}
+
+// ---------- LATENCY ----------
+void scannerRecordSubmit(const ScanTicket& scan) {
+  uint32_t us = (uint32_t)esp_timer_get_time() - scan.rx_us;
+  portENTER_CRITICAL(&scanStatsMux);
+  scanSubmits++;
+  scanSubmitSum += us;
+  if (us > scanStats.submit_max_us) scanStats.submit_max_us = us;
+  portEXIT_CRITICAL(&scanStatsMux);
+}
+
+void scannerRecordResult(const ScanTicket& scan) {
+  uint32_t ms = ((uint32_t)esp_timer_get_time() - scan.rx_us) / 1000;
+  portENTER_CRITICAL(&scanStatsMux);
+  scanStats.served++;
+  scanResultSum += ms;
+  if (ms > scanStats.result_max_ms) scanStats.result_max_ms = ms;
+  portEXIT_CRITICAL(&scanStatsMux);
+}
+
+ScannerStats getScannerStats() {
+  portENTER_CRITICAL(&scanStatsMux);
+  ScannerStats st = scanStats;
+  uint32_t submits = scanSubmits;
+  uint64_t submitSum = scanSubmitSum;
+  uint64_t resultSum = scanResultSum;
+  scanStats = ScannerStats();
+  scanSubmits = 0;
+  scanSubmitSum = 0;
+  scanResultSum = 0;
+  portEXIT_CRITICAL(&scanStatsMux);
+
+  st.submit_avg_us = submits ? (uint32_t)(submitSum / submits) : 0;
+  st.result_avg_ms = st.served ? (uint32_t)(resultSum / st.served) : 0;
+  return st;
+}
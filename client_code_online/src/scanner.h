@@ -0,0 +1,22 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include "config.h"
+#include "types.h"
+
+// ---------- QR SCANNER DRIVER ----------
+// The GM66 sends each code as one line on Serial, or as a bare burst ended
+// by the line going idle. Bytes are framed and parsed on the UART RX-timeout
+// callback (Serial.onReceive), and only tickets for this bakery reach
+// scannerTask through a queue.
+void initScanner();
+bool scannerNextTicket(ScanTicket& scan, TickType_t wait);
+void scannerRecordSubmit(const ScanTicket& scan);
+void scannerRecordResult(const ScanTicket& scan);
+
+// Recently served / rejected tickets, scannerTask only
+TicketVerdict scannerLookupTicket(int ticketId);
+void scannerRememberTicket(int ticketId, TicketVerdict verdict);
+ScannerStats getScannerStats();
+
+#endif
@@ -5,193 +5,17 @@
 #include "mutex.h"
 #include "display.h"
 #include "network.h"
+#include "errors.h"
+#include "input.h"
+#include "flow.h"
+#include "scanner.h"
+#include "waitlist.h"
+#include "buzzer.h"
+#include "printer.h"
+#include "customer_display.h"
 #include <HardwareSerial.h>
-#include <esp_now.h>
-
-// -----------------------------
-// CSN-A2 Printer (UART) Helpers
-// -----------------------------
-
-HardwareSerial printerSerial(1); // Use UART1 with custom pins (e.g., RX=16, TX=17)
-
-// Wrapper functions to send ESC/POS commands
-template <size_t N>
-void sendCommand(const byte (&command)[N]) {
-  printerSerial.write(command, N);
-}
-
-template <size_t N>
-void sendCommand(const byte (&command)[N], byte value) {
-  byte modifiedCommand[N];
-  for (size_t i = 0; i < N - 1; i++) {
-    modifiedCommand[i] = command[i];
-  }
-  modifiedCommand[N - 1] = value;
-  printerSerial.write(modifiedCommand, N);
-}
-
-template <size_t N>
-void sendCommand(const byte (&command)[N], byte nL, byte nH) {
-  byte modifiedCommand[N];
-  for (size_t i = 0; i < N - 2; i++) {
-    modifiedCommand[i] = command[i];
-  }
-  modifiedCommand[N - 2] = nL;
-  modifiedCommand[N - 1] = nH;
-  printerSerial.write(modifiedCommand, N);
-}
-
-// Minimal ESC/POS commands we actually use
-const byte lineFeed[]          = {10};                  // LF - new line
-const byte printAndFeedLines[] = {27, 100, 0};          // ESC d n - print and feed n lines
-const byte alignCenter[]       = {27, 97, 1};           // ESC a 1 - center alignment
-const byte fontSize[]          = {29, 33, 0};           // GS ! n - font size
-const byte boldOn[]            = {27, 69, 1};           // ESC E 1 - bold on
-const byte boldOff[]           = {27, 69, 0};           // ESC E 0 - bold off
-const byte resetPrinter[]      = {27, 64};              // ESC @ - reset
-
-static bool espNowInitialized = false;
-
-void initDisplayEspNow() {
-  if (espNowInitialized) {
-    return;
-  }
-
-  if (esp_now_init() != ESP_OK) {
-    Serial.println("ESP-NOW Init Failed!");
-    return;
-  }
-
-  esp_now_peer_info_t peer = {};
-  memcpy(peer.peer_addr, displayEspNowMac, 6);
-  peer.channel = 0;
-  peer.encrypt = false;
-
-  if (esp_now_add_peer(&peer) != ESP_OK) {
-    Serial.println("Failed to add ESP-NOW peer");
-    return;
-  }
-
-  espNowInitialized = true;
-}
-
-bool sendCustomerToDisplay(int ticketId) {
-  if (!espNowInitialized) {
-    initDisplayEspNow();
-  }
-
-  if (!espNowInitialized) {
-    return false;
-  }
-
-  int value = ticketId;
-  esp_err_t result = esp_now_send(displayEspNowMac, reinterpret_cast<const uint8_t*>(&value), sizeof(value));
-  if (result == ESP_OK) {
-    return true;
-  }
-
-  Serial.printf("ESP-NOW send failed (err=%d), re-adding peer and retrying...\n", result);
-  mqttPublishError(String("tasks:sendCustomerToDisplay:first_send_failed:err=") + String(result));
-
-  // Try to recover by re-adding the peer once, then retry send
-  esp_now_del_peer(displayEspNowMac);
-  espNowInitialized = false;
-  initDisplayEspNow();
-
-  if (!espNowInitialized) {
-    return false;
-  }
-
-  result = esp_now_send(displayEspNowMac, reinterpret_cast<const uint8_t*>(&value), sizeof(value));
-  if (result != ESP_OK) {
-    Serial.printf("ESP-NOW send failed again after reinit (err=%d)\n", result);
-    mqttPublishError(String("tasks:sendCustomerToDisplay:retry_failed:err=") + String(result));
-    return false;
-  }
-
-  return true;
-}
-
-// Fixed QR Code commands
-const byte qrModel[]      = {0x1D, 0x28, 0x6B, 0x04, 0x00, 0x31, 0x41, 0x32, 0x00}; // model 2
-const byte qrSize[]       = {0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x43, 0x06};        // size 6
-const byte qrErrorLevel[] = {0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x45, 0x31};        // level M
-const byte qrPrint[]      = {0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x51, 0x30};        // print
-
-// Print a QR code for the given URL/string
-void printQRCode(const char* data) {
-  // 1. Model
-  sendCommand(qrModel);
-
-  // 2. Size
-  sendCommand(qrSize);
-
-  // 3. Error correction level
-  sendCommand(qrErrorLevel);
-
-  // 4. Store data
-  int dataLength = strlen(data);
-  int pL = (dataLength + 3) % 256; // Low byte
-  int pH = (dataLength + 3) / 256; // High byte
-  byte qrDataHeader[] = {0x1D, 0x28, 0x6B, (byte)pL, (byte)pH, 0x31, 0x50, 0x30};
-  sendCommand(qrDataHeader);
-  printerSerial.write((const uint8_t*)data, dataLength);
-
-  // 5. Print QR code
-  sendCommand(qrPrint);
-
-  // 6. One line gap
-  sendCommand(lineFeed);
-}
-
-// Initialize printer lazily on first use
-void ensurePrinterInitialized() {
-  static bool initialized = false;
-  if (initialized) {
-    return;
-  }
-
-  // UART: 19200, 8N1, RX=16, TX=17 (adjust pins to your wiring)
-  printerSerial.begin(19200, SERIAL_8N1, 16, 17);
-  vTaskDelay(100 / portTICK_PERIOD_MS);
-
-  sendCommand(resetPrinter);
-  initialized = true;
-}
-
-// Print a simple ticket with customer ID and QR link, no dates
-void printCustomerTicket(int bakeryId, int ticketId) {
-  ensurePrinterInitialized();
-
-  sendCommand(alignCenter);
-
-  // Small label line
-  sendCommand(fontSize, 0x00);
-  printerSerial.println("Customer ID");
-  sendCommand(lineFeed);
-
-  // Big bold ticket ID
-  sendCommand(boldOn);
-  sendCommand(fontSize, 0x11); // double width & height (typical ESC/POS)
-
-  char idBuffer[16];
-  snprintf(idBuffer, sizeof(idBuffer), "%d", ticketId);
-  printerSerial.println(idBuffer);
-
-  sendCommand(boldOff);
-  sendCommand(fontSize, 0x00);
-
-  // Some vertical spacing
-  sendCommand(printAndFeedLines, 2);
-
-  // QR code with reservation URL
-  char urlBuffer[96];
-  snprintf(urlBuffer, sizeof(urlBuffer), "https://noonyar.ir/res/?b=%d&t=%d", bakeryId, ticketId);
-  printQRCode(urlBuffer);
-
-  // Feed a few lines so the user can tear the ticket
-  sendCommand(printAndFeedLines, 3);
-}
+#include <esp_timer.h>
+#include <atomic>
 
 // -----------------------------
 // GM66 Scanner Helpers (UART0)
@@ -208,26 +32,56 @@ void enableScanner() {
   Serial.write(scannerEnableCmd, sizeof(scannerEnableCmd));
 }
 
-void fetchInitTask(void* param) {
-    // Wait for WiFi and MQTT to be fully connected first
-    while (!isNetworkReady()) {
-      vTaskDelay(1000 / portTICK_PERIOD_MS);
+// ---------- BOOT ----------
+static BootStats bootStats;
+
+// Runs in setup() once the network layer exists: a valid cached config makes
+// the counter usable before WiFi, MQTT and /hardware_init are done.
+void warmStartFromFlash() {
+    if (!loadInitDataFromFlash()) {
+        Serial.println("No valid cached init data, cold start");
+        return;
     }
+    Serial.println("Warm start with " + String(bread_count) + " cached breads");
+    bootStats.warm = true;
+    bootStats.ready_ms = millis();
+    setInitDone(true);
+}
 
-    init_success = false;
+BootStats getBootStats() {
+    return bootStats;
+}
 
-    // We are now in init phase (after network but before fetchInitData)
-    setStatus(STATUS_INIT);
+// Warm started and the fresh config has not arrived yet
+bool isWarmStartSyncPending() {
+    return bootStats.warm && bootStats.synced_ms == 0;
+}
+
+void fetchInitTask(void* param) {
+    // Wait for WiFi and MQTT to be fully connected first
+    netWaitFor(NET_READY_BITS, portMAX_DELAY);
+
+    // A cold start is in init phase (after network but before fetchInitData);
+    // a warm one keeps working on the cached config meanwhile
+    if (!bootStats.warm) {
+        setInitDone(false);
+        setStatus(STATUS_INIT);
+    }
 
     while (!fetchInitData()) {
-        mqttPublishError("tasks:fetchInitTask failed. retrying ...");
+        reportError(ERR_TASK_INIT_RETRY);
         Serial.println("tasks:fetchInitTask failed");
         vTaskDelay(INIT_RETRY_DELAY / portTICK_PERIOD_MS);
     }
     // After basic init, try to restore cook display state from server
     apiInitCookDisplayFromServer();
-    setStatus(STATUS_NORMAL);
-    init_success = true;
+    if (!bootStats.warm || currentStatus == STATUS_INIT) {
+        setStatus(STATUS_NORMAL);
+    }
+
+    bootStats.synced_ms = millis();
+    if (!bootStats.warm) bootStats.ready_ms = bootStats.synced_ms;
+    setInitDone(true);
     vTaskDelete(NULL);
 }
 
@@ -246,7 +100,7 @@ void newCustomerTask(void* param) {
   int cid = apiNewCustomer(breads);
 
   if (cid == -1) {
-    mqttPublishError("tasks:newCustomerTask:failed");
+    reportError(ERR_TASK_NEW_CUSTOMER);
     setStatus(STATUS_API_ERROR);
     vTaskDelay(5000 / portTICK_PERIOD_MS);
     setStatus(STATUS_NORMAL);
@@ -346,561 +200,617 @@ void newCustomerTask(void* param) {
 //   return totalTime;
 // }
 
+// Pushed current-ticket states and poll requests for ticketFlowTask. Depth 1
+// with overwrite: only the newest server state matters.
+static QueueHandle_t ticketFlowQueue = NULL;
+
+void initTicketFlow() {
+  if (!ticketFlowQueue) {
+    ticketFlowQueue = xQueueCreate(1, sizeof(TicketFlowEvent));
+  }
+}
+
+bool pushCurrentTicketState(const CurrentTicketState& state) {
+  if (!ticketFlowQueue) return false;
+  TicketFlowEvent ev;
+  ev.type = TICKET_EVENT_STATE;
+  ev.state = state;
+  return xQueueOverwrite(ticketFlowQueue, &ev) == pdTRUE;
+}
+
+bool requestTicketFlowPoll() {
+  if (!ticketFlowQueue) return false;
+  TicketFlowEvent ev;
+  ev.type = TICKET_EVENT_POLL;
+  // Never replace a pushed state with a bare poll request
+  return xQueueSend(ticketFlowQueue, &ev, (TickType_t)0) == pdTRUE;
+}
+
 void ticketFlowTask(void* param) {
   const unsigned long POLL_INTERVAL_NO_CUSTOMER = 300000UL;
-  unsigned long lastCheckTime = 0;
+  unsigned long nextPollAt = 0;
+  unsigned long lastPushAt = 0;
+  bool pushSeen = false;
+  int lastAnnouncedTicket = -1;
+  TicketFlowEvent ev;
   
   while (true) {
 
-      if (!(init_success && isNetworkReadyForApi())) {
+      if (!netWaitFor(NET_API_BITS | NET_BIT_INIT_DONE, 0)) {
         Serial.println("ticketFlowTask:Waiting for init/network...");
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
+        netWaitFor(NET_API_BITS | NET_BIT_INIT_DONE, portMAX_DELAY);
         continue;
       }
-      
+
+      // Block until the server pushes a new state, or until the next HTTP
+      // poll is due. A push always preempts the wait.
       unsigned long now = millis();
-      
-      if (!hasCustomerInQueue && (now - lastCheckTime < POLL_INTERVAL_NO_CUSTOMER)) {
-        Serial.println("ticketFlowTask:no customer in queue and POLL_INTERVAL_NO_CUSTOMER not passed.");
-        vTaskDelay(10000 / portTICK_PERIOD_MS);
-        continue;
+      long waitMs = (long)(nextPollAt - now);
+      TickType_t waitTicks = waitMs > 0 ? (TickType_t)(waitMs / portTICK_PERIOD_MS) : 0;
+
+      CurrentTicketResponse cur;
+      bool fromPush = false;
+
+      if (xQueueReceive(ticketFlowQueue, &ev, waitTicks) == pdTRUE && ev.type == TICKET_EVENT_STATE) {
+        static_cast<CurrentTicketState&>(cur) = ev.state;
+        fromPush = true;
+        pushSeen = true;
+        lastPushAt = millis();
+      } else {
+        Serial.println("ticketFlowTask:hasCustomerInQueue:" + String(hasCustomerInQueue) + "| poll due or requested");
+        cur = apiCurrentTicket();
       }
-      
-      Serial.println("ticketFlowTask:hasCustomerInQueue:" + String(hasCustomerInQueue) + "| or time passed");
-      CurrentTicketResponse cur = apiCurrentTicket();
-      
-      lastCheckTime = now;
-      Serial.println(String("ticketFlowTask:current_ticket_id: ") + String(cur.current_ticket_id) + " | has_customer_in_queue: " + cur.has_customer_in_queue);
+
+      now = millis();
+      bool pushLive = pushSeen && (now - lastPushAt < TICKET_PUSH_SILENCE_MS);
+      Serial.println(String("ticketFlowTask:current_ticket_id: ") + String(cur.current_ticket_id) + " | has_customer_in_queue: " + cur.has_customer_in_queue + (fromPush ? " (push)" : " (poll)"));
 
       if (cur.has_customer_in_queue == false) {
-        Serial.println("ticketFlowTask:5 second delay");
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
+        // Woken early by a push or by has_customer_in_queue_update
+        hasCustomerInQueue = false;
+        waitDeadline = 0;
+        nextPollAt = now + POLL_INTERVAL_NO_CUSTOMER;
         continue;
       }
 
       if (!cur.error.isEmpty() || cur.current_ticket_id < 0) {
         Serial.println("ticketFlowTask:error or no current_ticket_id. 10 sec delay");
-        vTaskDelay(10000 / portTICK_PERIOD_MS);
+        nextPollAt = now + 10000UL;
         continue;
       }
       if (cur.ready == true){
-        // TODO: CALL CUSTOMER 
-        Serial.println("ticketFlowTask:breads are ready!");
-
-        sendCustomerToDisplay(cur.current_ticket_id);
-
-        currentTicketID = cur.current_ticket_id;
-        bool resp = apiSendTicketToWaitList(currentTicketID);
-        if (!resp) {mqttPublishError("tasks:ticketFlowTask:apiSendTicketToWaitList reponse is false");}
+        waitDeadline = 0;
+        // A push and a poll can report the same ready ticket; announce it once
+        if (cur.current_ticket_id != lastAnnouncedTicket) {
+          // TODO: CALL CUSTOMER 
+          Serial.println("ticketFlowTask:breads are ready!");
+
+          customerDisplayCall(cur.current_ticket_id);
+
+          currentTicketID = cur.current_ticket_id;
+          bool resp = apiSendTicketToWaitList(currentTicketID);
+          if (!resp) {reportError(ERR_TASK_WAIT_LIST, currentTicketID);}
+          else {
+            lastAnnouncedTicket = currentTicketID;
+            waitListAdd(currentTicketID, cur.bread_counts, cur.bread_count);
+          }
+        }
+        // With a live push channel the next state arrives by itself
+        nextPollAt = millis() + (pushLive ? TICKET_PUSH_FALLBACK_MS : 0UL);
       }
       else {
-        waitDeadline = millis() + (cur.wait_until * 1000UL);
+        waitDeadline = now + ((cur.wait_until > 0 ? cur.wait_until : 1) * 1000UL);
         Serial.println("ticketFlowTask:breads are not ready. wait until" + String(cur.wait_until));
-        while (millis() <= waitDeadline) {
-          vTaskDelay(1000 / portTICK_PERIOD_MS);
-        }
+        nextPollAt = waitDeadline;
       }
   }
 }
 
-void scannerTask(void *pvParameters) {
-    while (1) {
-        // Only process scans when network and init are ready
-        if (!(init_success && isNetworkReady())) {
-            vTaskDelay(500 / portTICK_PERIOD_MS);
-            continue;
-        }
+// Put a delivery up and hold further scans until the baker accepts it
+static void startDelivery(const int* counts) {
+    // Directly map ServeTicketResponse bread_counts into delivery display slots
+    bread1_delivery_display = counts[0];
+    bread2_delivery_display = counts[1];
+    bread3_delivery_display = counts[2];
 
-        // Do not accept new scans while a delivery is pending
-        if (deliveryPending) {
-            vTaskDelay(100 / portTICK_PERIOD_MS);
-            continue;
-        }
+    // Mark that a delivery is now pending baker confirmation
+    flowDispatch(FLOW_EV_DELIVERY);
 
-        if (Serial.available()) {
-            String qr = Serial.readStringUntil('\n');
-            int pos = qr.indexOf("t=");
-            if (pos != -1) {
-                int ticket_id = qr.substring(pos + 2).toInt();
-
-                Serial.print("Scanned Ticket ID: ");
-                Serial.println(ticket_id);
-                
-                ServeTicketResponse resp = apiServeTicket(ticket_id);
-                if (!resp.error.isEmpty()) {
-                    if (resp.error == "ticket_is_not_in_wait_list") {
-                        Serial.println("ticket_is_not_in_wait_list"); 
-                        // BUZZER pattern: 3 short beeps (200ms on, 100ms off)
-                        for (int i = 0; i < 3; ++i) {
-                            digitalWrite(BUZZER_PIN, HIGH);
-                            vTaskDelay(200 / portTICK_PERIOD_MS);
-                            digitalWrite(BUZZER_PIN, LOW);
-                            if (i < 2) {
-                                vTaskDelay(100 / portTICK_PERIOD_MS);
-                            }
-                        }
-                    } else {
-                        mqttPublishError("tasks:scannerTask:apiNextTicke reponse failed: " + resp.error);
-                    }
-                } else {
-                    // success
-                    Serial.println("success: " + String(resp.bread_counts[0]) + String(resp.bread_counts[1])); 
-                    // Directly map ServeTicketResponse bread_counts into delivery display slots
-                    bread1_delivery_display = resp.bread_counts[0];
-                    bread2_delivery_display = resp.bread_counts[1];
-                    bread3_delivery_display = resp.bread_counts[2];
-
-                    // Mark that a delivery is now pending baker confirmation
-                    deliveryPending = true;
-
-                    // If nothing is currently shown, switch to delivery mode now
-                    if (displayMode == DISPLAY_MODE_NONE) {
-                      displayMode = DISPLAY_MODE_DELIVERY;
-                    }
-                    showDeliveryDisplay();
-
-                    // Disable scanner light/scan while this delivery is pending
-                    disableScanner();
-
-                    // BUZZER success pattern: single 300ms beep
-                    digitalWrite(BUZZER_PIN, HIGH);
-                    vTaskDelay(300 / portTICK_PERIOD_MS);
-                    digitalWrite(BUZZER_PIN, LOW);
-                }
+    // Disable scanner light/scan while this delivery is pending
+    disableScanner();
+
+    buzzerPlay(BUZZER_SUCCESS);
+}
+
+// Only a 404 from serve_ticket says the ticket is not the server's to serve;
+// every other error means the request did not get a usable answer
+static bool isServeRejection(const ServeTicketResponse& resp) {
+    return resp.error == "ticket_is_not_in_wait_list";
+}
+
+// `shown` holds the counts already put up from the wait-list mirror, or NULL
+static void handleServeTicketResult(int ticketId, const ServeTicketResponse& resp, const int* shown) {
+    if (!resp.error.isEmpty()) {
+        if (shown && !isServeRejection(resp)) {
+            // The mirror had it and the server never answered: the delivery
+            // stays up, the missing serve is left for the server side
+            reportError(ERR_TASK_SERVE_TICKET, ticketId);
+            return;
+        }
+        if (shown) {
+            // The server disagrees with the mirror: take the delivery back,
+            // unless the baker already accepted it
+            waitListRecordRevert();
+            if (flowDispatch(FLOW_EV_DELIVERY_CANCEL)) {
+                enableScanner();
             }
         }
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+        if (isServeRejection(resp)) {
+            Serial.println("ticket_is_not_in_wait_list"); 
+            scannerRememberTicket(ticketId, TICKET_NOT_IN_WAIT_LIST);
+            buzzerPlay(BUZZER_REJECTED);
+        } else {
+            reportError(ERR_TASK_SERVE_TICKET);
+            buzzerPlay(BUZZER_ERROR);
+        }
+        return;
     }
-}
 
-void breadButtonsTask(void* param) {
-  int rowPins[3] = { ROW1_PIN, ROW2_PIN, ROW3_PIN };
-  int colPins[3] = { COL1_PIN, COL2_PIN, COL3_PIN };
+    // success
+    Serial.println("success: " + String(resp.bread_counts[0]) + String(resp.bread_counts[1])); 
+    scannerRememberTicket(ticketId, TICKET_SERVED);
 
-  bool buttonState[3][3] = { { false, false, false }, { false, false, false }, { false, false, false } };
-  bool lastButtonState[3][3] = { { false, false, false }, { false, false, false }, { false, false, false } };
-  unsigned long lastDebounceTime[3][3];
-  for (int r = 0; r < 3; r++) {
-    for (int c = 0; c < 3; c++) {
-      lastDebounceTime[r][c] = 0;
+    if (!shown) {
+        startDelivery(resp.bread_counts);
+        return;
     }
-  }
-
-  const unsigned long debounceDelay = 50;
 
-  // Init rows as outputs, set HIGH
-  for (int i = 0; i < 3; i++) {
-    pinMode(rowPins[i], OUTPUT);
-    digitalWrite(rowPins[i], HIGH);
-  }
+    // Already shown and beeped; correct the digits if the server's counts differ
+    if (shown[0] != resp.bread_counts[0] || shown[1] != resp.bread_counts[1] || shown[2] != resp.bread_counts[2]) {
+        waitListRecordCorrection();
+        if (flowDeliveryPending()) {
+            bread1_delivery_display = resp.bread_counts[0];
+            bread2_delivery_display = resp.bread_counts[1];
+            bread3_delivery_display = resp.bread_counts[2];
+            showDeliveryDisplay();
+        }
+    }
+}
 
-  // Init cols as inputs with pullups
-  for (int i = 0; i < 3; i++) {
-    pinMode(colPins[i], INPUT_PULLUP);
-  }
+void scannerTask(void *pvParameters) {
+    static ApiResult serveResult;
+    ScanTicket scan;
 
-  while (1) {
-    // Only respond to buttons when network and init are ready
-    if (!(init_success && isNetworkReady())) {
-      vTaskDelay(100 / portTICK_PERIOD_MS);
-      continue;
-    }
+    while (1) {
+        // Further scans wait in the scanner queue while one is handled
+        if (!scannerNextTicket(scan, portMAX_DELAY)) {
+            continue;
+        }
 
-    // Scan each row
-    for (int row = 0; row < 3; row++) {
-      // Set current row LOW, others HIGH
-      for (int i = 0; i < 3; i++) {
-        digitalWrite(rowPins[i], (i == row) ? LOW : HIGH);
-      }
+        Serial.print("Scanned Ticket ID: ");
+        Serial.println(scan.ticket_id);
 
-      // Small settle delay
-      delayMicroseconds(10);
+        // Repeats of a ticket the server just answered are answered locally
+        TicketVerdict cached = scannerLookupTicket(scan.ticket_id);
+        if (cached == TICKET_SERVED) {
+            Serial.println("Ticket already served");
+            buzzerPlay(BUZZER_DUPLICATE);
+            continue;
+        }
+        // ...unless the ticket has joined the wait list since
+        if (cached == TICKET_NOT_IN_WAIT_LIST && !waitListContains(scan.ticket_id)) {
+            Serial.println("ticket_is_not_in_wait_list (cached)");
+            buzzerPlay(BUZZER_REJECTED);
+            continue;
+        }
 
-      // Read all columns
-      for (int col = 0; col < 3; col++) {
-        bool reading = (digitalRead(colPins[col]) == LOW); // LOW = pressed
+        // Never start on a scan while a delivery is still pending
+        flowWaitNoDelivery(portMAX_DELAY);
 
-        if (reading != lastButtonState[row][col]) {
-          lastDebounceTime[row][col] = millis();
+        // A ticket the wait-list mirror knows is shown and beeped right away;
+        // the server's answer then confirms, corrects or reverts it
+        int shownCounts[3];
+        bool shown = waitListTake(scan.ticket_id, shownCounts);
+        if (shown) {
+            startDelivery(shownCounts);
         }
 
-        if ((millis() - lastDebounceTime[row][col]) > debounceDelay) {
-          if (reading != buttonState[row][col]) {
-            buttonState[row][col] = reading;
-
-            if (buttonState[row][col]) {
-              Serial.print("Button PRESSED (row,col): ");
-              Serial.print(row);
-              Serial.print(", ");
-              Serial.println(col);
-              if (deliveryPending && displayMode == DISPLAY_MODE_DELIVERY && row == 1 && col == 2) {
-                // Accept delivery only on Row1, Col2 when delivery is currently shown
-                bread1_delivery_display = 0;
-                bread2_delivery_display = 0;
-                bread3_delivery_display = 0;
-                lc.setRow(1, 0, 0);
-                lc.setRow(1, 5, 0);
-                lc.setRow(1, 1, 0);
-                deliveryPending = false;
-
-                // Re-enable scanner once baker has confirmed this delivery
-                enableScanner();
+        // A delivery already on the display is worth retrying for; without
+        // one the customer just scans again
+        int attempts = shown ? SERVE_TICKET_ATTEMPTS : 1;
+        bool submitted = false;
+        for (int attempt = 0; attempt < attempts; attempt++) {
+            if (attempt > 0) vTaskDelay(SERVE_TICKET_RETRY_MS / portTICK_PERIOD_MS);
+
+            // Only serve when network and init are ready
+            netWaitFor(NET_READY_BITS | NET_BIT_INIT_DONE, portMAX_DELAY);
 
-                // If there is a pending baker reservation, show it now
-                int bakerTotal = bread1_count_baker_display + bread2_count_baker_display + bread3_count_baker_display;
-                if (bakerTotal > 0) {
-                  displayMode = DISPLAY_MODE_BAKER;
-                  showBakerDisplay();
-                } else {
-                  displayMode = DISPLAY_MODE_NONE;
-                  showBakerDisplay();
-                }
-              } else if (confirmationMode) {
-                // In confirmation mode, buttons act as ACCEPT/REJECT only
-                if (row == 1 && col == 2) {
-                  // Accept (Row2, Col3) -> send order to server
-                  confirmationAccepted = true;
-
-                  // Build breads vector mapped from bread1..3 to breads_id
-                  std::vector<int> breads;
-                  breads.reserve(bread_count);
-                  for (int i = 0; i < bread_count; ++i) {
-                    if (i == 0)      breads.push_back(bread1_count);
-                    else if (i == 1) breads.push_back(bread2_count);
-                    else if (i == 2) breads.push_back(bread3_count);
-                    else             breads.push_back(0);
-                  }
-
-                  // While apiNewCustomer is running, confirmationMode stays true.
-                  // uploadInProgress enables baker display animation.
-                  uploadInProgress = true;
-                  int cid = apiNewCustomer(breads);
-                  if (cid == -1) {
-                    mqttPublishError("tasks:breadButtonsTask:apiNewCustomer failed");
-                    setStatus(STATUS_API_ERROR);
-                    // Reset baker display counts on failure
-                    bread1_count_baker_display = 0;
-                    bread2_count_baker_display = 0;
-                    bread3_count_baker_display = 0;
-                    showOwnerBreadCounts();
-                    uploadInProgress = false;
-                    confirmationMode = false;
-                    vTaskDelay(5000 / portTICK_PERIOD_MS);
-                    setStatus(STATUS_NORMAL);
-
-                    // After finishing (failed) baker confirmation, if a delivery is pending, show it; otherwise clear display mode
-                    int deliveryTotal = bread1_delivery_display + bread2_delivery_display + bread3_delivery_display;
-                    if (deliveryPending && deliveryTotal > 0) {
-                      displayMode = DISPLAY_MODE_DELIVERY;
-                      showDeliveryDisplay();
-                    } else {
-                      displayMode = DISPLAY_MODE_NONE;
-                      showBakerDisplay();
-                    }
-                  } else {
-                    // Save current counts before we reset them
-                    int c1 = bread1_count;
-                    int c2 = bread2_count;
-                    int c3 = bread3_count;
-
-                    currentTicketID = cid;
-
-                    // Print ticket for customer with QR code and numeric ID
-                    int bakeryIdInt = atoi(bakery_id);
-                    printCustomerTicket(bakeryIdInt, currentTicketID);
-
-                    // If API says to show on display, update cook display values
-                    if (last_show_on_display) {
-                      bread1_cook_display = c1;
-                      bread2_cook_display = c2;
-                      bread3_cook_display = c3;
-                    }
-
-                    // Success: reset bread counts and delivery display, unlock buttons
-                    bread1_count = 0;
-                    bread2_count = 0;
-                    bread3_count = 0;
-                    num1 = bread1_count;
-                    num2 = bread2_count;
-                    num3 = bread3_count;
-
-                    bread1_count_baker_display = 0;
-                    bread2_count_baker_display = 0;
-                    bread3_count_baker_display = 0;
-
-                    // Clear baker digits (1,6 / 1,4 / 1,3)
-                    lc.setRow(1, 6, 0);
-                    lc.setRow(1, 4, 0);
-                    lc.setRow(1, 3, 0);
-
-                    uploadInProgress = false;
-                    confirmationMode = false;
-                    setStatus(STATUS_NORMAL);
-
-                    // After successful baker confirmation, if a delivery is pending, show it; otherwise clear display mode
-                    int deliveryTotal = bread1_delivery_display + bread2_delivery_display + bread3_delivery_display;
-                    if (deliveryPending && deliveryTotal > 0) {
-                      displayMode = DISPLAY_MODE_DELIVERY;
-                      showDeliveryDisplay();
-                    } else {
-                      displayMode = DISPLAY_MODE_NONE;
-                      showBakerDisplay();
-                    }
-                  }
-                } else if (row == 2 && col == 2) {
-                  // Reject (Row3, Col3): clear owner display, reset bread counts and baker displays
-                  confirmationAccepted = false;
-                  confirmationMode = false;
-                  uploadInProgress = false;
-
-                  bread1_count = 0;
-                  bread2_count = 0;
-                  bread3_count = 0;
-                  num1 = bread1_count;
-                  num2 = bread2_count;
-                  num3 = bread3_count;
-
-                  bread1_count_baker_display = 0;
-                  bread2_count_baker_display = 0;
-                  bread3_count_baker_display = 0;
-
-                  // Clear owner digits on device 1
-                  lc.setRow(1, 6, 0);
-                  lc.setRow(1, 4, 0);
-                  lc.setRow(1, 3, 0);
-
-                  // Show reset counts on main display (0,0 - 0,2 - 0,3)
-                  showNumbers(num1, num2, num3);
-
-                  // After rejecting baker confirmation, if a delivery is pending, show it; otherwise clear display mode
-                  int deliveryTotal = bread1_delivery_display + bread2_delivery_display + bread3_delivery_display;
-                  if (deliveryPending && deliveryTotal > 0) {
-                    displayMode = DISPLAY_MODE_DELIVERY;
-                    showDeliveryDisplay();
-                  } else {
-                    displayMode = DISPLAY_MODE_NONE;
-                    showBakerDisplay();
-                  }
-                }
-              } else {
-                // Normal bread increment/decrement logic
-                int totalBefore = bread1_count + bread2_count + bread3_count;
-                int totalAfter = totalBefore;
-
-                if (row == 0 && col == 0) {
-                  if (bread1_count > 0) {
-                    bread1_count--;
-                    totalAfter--;
-                  }
-                } else if (row == 0 && col == 1) {
-                  if (bread1_count < MAX_BREAD_PER_TYPE && totalBefore < max_total_breads) {
-                    bread1_count++;
-                    totalAfter++;
-                  }
-                } else if (row == 1 && col == 0) {
-                  if (bread2_count > 0) {
-                    bread2_count--;
-                    totalAfter--;
-                  }
-                } else if (row == 1 && col == 1) {
-                  if (bread2_count < MAX_BREAD_PER_TYPE && totalBefore < max_total_breads) {
-                    bread2_count++;
-                    totalAfter++;
-                  }
-                } else if (row == 2 && col == 0) {
-                  if (bread3_count > 0) {
-                    bread3_count--;
-                    totalAfter--;
-                  }
-                } else if (row == 2 && col == 1) {
-                  if (bread3_count < MAX_BREAD_PER_TYPE && totalBefore < max_total_breads) {
-                    bread3_count++;
-                    totalAfter++;
-                  }
-                }
-
-                if (totalAfter != totalBefore) {
-                  num1 = bread1_count;
-                  num2 = bread2_count;
-                  num3 = bread3_count;
-                  showNumbers(num1, num2, num3);
-                }
-              }
-            } else {
-              Serial.print("Button RELEASED (row,col): ");
-              Serial.print(row);
-              Serial.print(", ");
-              Serial.println(col);
+            if (!apiServeTicketAsync(scan.ticket_id, &serveResult, xTaskGetCurrentTaskHandle())) {
+                serveResult.serve = ServeTicketResponse();
+                serveResult.serve.error = "submit_failed";
+                continue;
             }
-          }
+            if (!submitted) scannerRecordSubmit(scan);
+            submitted = true;
+
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            if (serveResult.serve.error.isEmpty() || isServeRejection(serveResult.serve)) break;
         }
 
-        lastButtonState[row][col] = reading;
-      }
+        if (!submitted && !shown) continue;
+        if (submitted) scannerRecordResult(scan);
+        handleServeTicketResult(scan.ticket_id, serveResult.serve, shown ? shownCounts : NULL);
     }
+}
 
-    vTaskDelay(10 / portTICK_PERIOD_MS);
-  }
+// ---------- ORDER SUBMISSION WORKER ----------
+// Accepting an order on the keypad only snapshots the counts into orderQueue
+// and hands the keypad straight back for the next customer. orderWorkerTask
+// submits, prints and updates the display one order at a time, strictly in
+// accept order, and owns the 5 s error screen.
+static QueueHandle_t orderQueue = NULL;
+static QueueHandle_t failedOrderQueue = NULL;   // back to the keypad for a retry
+static std::atomic<int> ordersPending(0);   // queued + in flight
+static std::atomic<bool> ordersOffline(false);  // worker gave up waiting for the API
+static uint32_t orderSeq = 0;
+static uint32_t ordersSubmitted = 0;
+static uint32_t ordersFailed = 0;
+
+void initOrderWorker() {
+  orderQueue = xQueueCreate(ORDER_QUEUE_DEPTH, sizeof(OrderRequest));
+  // Every queued order plus the one in flight can fail
+  failedOrderQueue = xQueueCreate(ORDER_QUEUE_DEPTH + 1, sizeof(OrderRequest));
+}
+
+int getOrderQueueDepth() {
+  return ordersPending.load();
+}
+
+void getOrderStats(uint32_t& submitted, uint32_t& failed) {
+  submitted = ordersSubmitted;
+  failed = ordersFailed;
 }
 
+// Keypad side, in confirmation mode; false (and still confirming) when the
+// queue is full or the worker is offline
+static bool submitOrder(int c1, int c2, int c3) {
+  if (!orderQueue || ordersOffline || uxQueueSpacesAvailable(orderQueue) == 0) return false;
+
+  OrderRequest order;
+  order.seq = ++orderSeq;
+  order.counts[0] = c1;
+  order.counts[1] = c2;
+  order.counts[2] = c3;
+
+  // Counted before it is queued so the worker can never drain first; only
+  // this task sends, so the space checked above is still there
+  ordersPending++;
+  flowDispatch(FLOW_EV_ACCEPT);
+  xQueueSend(orderQueue, &order, (TickType_t)0);
+  return true;
+}
 
-void confirmButtonTask(void* param) {
-  pinMode(CONFIRM_BUTTON_PIN, INPUT_PULLUP);
+// The keypad cleared the counts on accept; hand a failed order back so the
+// cashier can confirm it again. A ticket POST is never retried blindly: the
+// server may have issued it before the connection dropped.
+static void returnFailedOrder(const OrderRequest& order) {
+  if (!failedOrderQueue || xQueueSend(failedOrderQueue, &order, (TickType_t)0) != pdTRUE) return;
+
+  InputEvent ev;
+  ev.type = INPUT_EVENT_ORDER_FAILED;
+  ev.key = 0;
+  ev.keys = 0;
+  ev.edge_us = ev.at_us = (uint32_t)esp_timer_get_time();
+  inputPostEvent(ev, portMAX_DELAY);
+}
 
-  int lastReading = HIGH;
-  int stableState = HIGH;
-  unsigned long lastDebounceTime = 0;
-  const unsigned long debounceDelay = 50;
+static void processOrder(const OrderRequest& order, unsigned long& errorUntil) {
+  // Build breads vector mapped from bread1..3 to breads_id
+  std::vector<int> breads;
+  breads.reserve(bread_count);
+  for (int i = 0; i < bread_count; ++i) {
+    breads.push_back(i < 3 ? order.counts[i] : 0);
+  }
 
-  while (1) {
-    // Only allow confirmation when network and init are ready
-    if (!(init_success && isNetworkReady())) {
-      vTaskDelay(100 / portTICK_PERIOD_MS);
-      continue;
-    }
+  // The printer gets the ticket header while the request is in flight
+  bool ticketBegun = printerBeginTicket();
+
+  int cid = apiNewCustomer(breads);
+  bool showOnDisplay = last_show_on_display;
+
+  if (cid == -1) {
+    if (ticketBegun) printerVoidTicket();
+    ordersFailed++;
+    reportError(ERR_TASK_ORDER_SUBMIT, order.seq);
+    returnFailedOrder(order);
+    setStatus(STATUS_API_ERROR);
+    // Error stays on screen for 5s; the worker restores it between orders
+    errorUntil = millis() + 5000;
+    return;
+  }
 
-    int reading = digitalRead(CONFIRM_BUTTON_PIN);
+  ordersSubmitted++;
+  currentTicketID = cid;
 
-    // If the reading changed, reset debounce timer
-    if (reading != lastReading) {
-      lastDebounceTime = millis();
+  // Finish the ticket with the numeric ID and QR code
+  int bakeryIdInt = atoi(bakery_id);
+  if (!printerFinishTicket(bakeryIdInt, cid, ticketBegun)) {
+    Serial.println("Printer queue full, ticket " + String(cid) + " not printed");
+  }
+
+  // If API says to show on display, update cook display values
+  if (showOnDisplay) {
+    bread1_cook_display = order.counts[0];
+    bread2_cook_display = order.counts[1];
+    bread3_cook_display = order.counts[2];
+    showCookDisplay();
+  }
+}
+
+void orderWorkerTask(void* param) {
+  OrderRequest order;
+  unsigned long errorUntil = 0;
+
+  while (1) {
+    TickType_t wait = portMAX_DELAY;
+    if (errorUntil != 0) {
+      long left = (long)(errorUntil - millis());
+      wait = left > 0 ? left / portTICK_PERIOD_MS : 0;
     }
 
-    if ((millis() - lastDebounceTime) > debounceDelay) {
-      // If the debounced state changed, act on edges
-      if (reading != stableState) {
-        // Detect button press: HIGH -> LOW
-        if (stableState == HIGH && reading == LOW) {
-          if (!confirmationMode && currentStatus == STATUS_NORMAL) {
-            int totalBread = bread1_count + bread2_count + bread3_count;
-            if (totalBread <= 0) {
-              Serial.println("Confirm button ignored: all bread counts are zero");
-            } else {
-              Serial.println("Confirm button pressed -> entering confirmation mode");
-              confirmationMode = true;
-              confirmationAccepted = false;
-              uploadInProgress = false;
-
-              // Copy current bread counts into baker display variables
-              bread1_count_baker_display = bread1_count;
-              bread2_count_baker_display = bread2_count;
-              bread3_count_baker_display = bread3_count;
-
-              // If no display is active, switch to baker mode now
-              if (displayMode == DISPLAY_MODE_NONE) {
-                displayMode = DISPLAY_MODE_BAKER;
-              }
-              showBakerDisplay();
-            }
-          }
-        }
-        stableState = reading;
+    if (xQueueReceive(orderQueue, &order, wait) == pdTRUE) {
+      // After a warm start orders can be accepted before the API is reachable.
+      // Past ORDER_NET_WAIT_MS the keypad stops taking new ones and shows the
+      // waiting pattern until the link is back; queued orders are kept.
+      if (!netWaitFor(NET_API_BITS, ORDER_NET_WAIT_MS / portTICK_PERIOD_MS)) {
+        reportError(ERR_TASK_ORDER_OFFLINE, order.seq);
+        ordersOffline = true;
+        setStatus(STATUS_API_WAITING);
+        netWaitFor(NET_API_BITS, portMAX_DELAY);
+        ordersOffline = false;
+        setStatus(STATUS_NORMAL);
+      }
+      processOrder(order, errorUntil);
+
+      if (--ordersPending == 0) {
+        flowDispatch(FLOW_EV_ORDERS_DRAINED);
       }
     }
 
-    lastReading = reading;
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    if (errorUntil != 0 && (long)(millis() - errorUntil) >= 0) {
+      errorUntil = 0;
+      setStatus(STATUS_NORMAL);
+    }
   }
 }
 
-void confirmAnimationTask(void* param) {
-  // Segment animation masks (one segment on at a time)
-  const byte segmentMasks[6] = {
-    0b01000000, // A
-    0b00100000, // B
-    0b00010000, // C
-    0b00001000, // D
-    0b00000100, // E
-    0b00000010  // F
-  };
-
-  int step = 0;
+// Pending apiNewBread submitted from the new-bread button
+static ApiResult newBreadResult;
+static bool newBreadInFlight = false;
+static unsigned long newBreadErrorUntil = 0;
+
+// Runs on the API worker: hand the completion to inputHandlerTask. Blocks if
+// the queue is full rather than losing it, which would wedge the in-flight flag.
+static void postApiDone(ApiResult& result, void* ctx) {
+  InputEvent ev;
+  ev.type = INPUT_EVENT_API_DONE;
+  ev.key = (uint8_t)result.type;
+  ev.keys = 0;
+  ev.edge_us = ev.at_us = (uint32_t)esp_timer_get_time();
+  inputPostEvent(ev, portMAX_DELAY);
+}
 
-  while (1) {
-    if (confirmationMode && currentStatus == STATUS_NORMAL) {
-      byte mask = segmentMasks[step];
-
-      // Always animate customer-facing digits 0,2,3 on device 0
-      lc.setRow(0, 0, mask);
-      lc.setRow(0, 2, mask);
-      lc.setRow(0, 3, mask);
-
-      // Only touch baker-side digits when baker display is the active mode
-      if (displayMode == DISPLAY_MODE_BAKER) {
-        if (uploadInProgress) {
-          // During upload, animate baker display digits 1,6 / 1,4 / 1,3
-          lc.setRow(1, 6, mask);
-          lc.setRow(1, 4, mask);
-          lc.setRow(1, 3, mask);
-        } else {
-          // Before accept, keep baker display showing static counts
-          showOwnerBreadCounts();
-        }
+// Keypad press at (row, col)
+static void handleMatrixPress(int row, int col) {
+  Serial.print("Button PRESSED (row,col): ");
+  Serial.print(row);
+  Serial.print(", ");
+  Serial.println(col);
+  if (row == 1 && col == 2 && flowDeliveryPending() && flowDispatch(FLOW_EV_DELIVERY_DONE)) {
+    // Accept delivery only on Row1, Col2 when delivery is currently shown;
+    // re-enable scanner once baker has confirmed this delivery
+    enableScanner();
+  } else if (flowIsConfirming()) {
+    // In confirmation mode, buttons act as ACCEPT/REJECT only
+    if (row == 1 && col == 2) {
+      // Accept (Row2, Col3) -> queue the order for the order worker
+      if (!submitOrder(bread1_count, bread2_count, bread3_count)) {
+        // Stay in confirmation mode so the baker can accept again
+        reportError(ERR_TASK_ORDER_SUBMIT);
+        Serial.println("Order queue full or offline, accept ignored");
+        return;
+      }
+      // The keypad is free for the next customer right away. Baker digits
+      // keep the accepted counts (animated while uploading) until the
+      // worker is done with it.
+      bread1_count = 0;
+      bread2_count = 0;
+      bread3_count = 0;
+      num1 = bread1_count;
+      num2 = bread2_count;
+      num3 = bread3_count;
+      showNumbers(num1, num2, num3);
+    } else if (row == 2 && col == 2) {
+      // Reject (Row3, Col3): clear baker displays and reset bread counts
+      flowDispatch(FLOW_EV_REJECT);
+
+      bread1_count = 0;
+      bread2_count = 0;
+      bread3_count = 0;
+      num1 = bread1_count;
+      num2 = bread2_count;
+      num3 = bread3_count;
+
+      // Show reset counts on main display (0,0 - 0,2 - 0,3)
+      showNumbers(num1, num2, num3);
+    }
+  } else {
+    // Normal bread increment/decrement logic
+    int totalBefore = bread1_count + bread2_count + bread3_count;
+    int totalAfter = totalBefore;
+
+    if (row == 0 && col == 0) {
+      if (bread1_count > 0) {
+        bread1_count--;
+        totalAfter--;
+      }
+    } else if (row == 0 && col == 1) {
+      if (bread1_count < MAX_BREAD_PER_TYPE && totalBefore < max_total_breads) {
+        bread1_count++;
+        totalAfter++;
+      }
+    } else if (row == 1 && col == 0) {
+      if (bread2_count > 0) {
+        bread2_count--;
+        totalAfter--;
+      }
+    } else if (row == 1 && col == 1) {
+      if (bread2_count < MAX_BREAD_PER_TYPE && totalBefore < max_total_breads) {
+        bread2_count++;
+        totalAfter++;
+      }
+    } else if (row == 2 && col == 0) {
+      if (bread3_count > 0) {
+        bread3_count--;
+        totalAfter--;
+      }
+    } else if (row == 2 && col == 1) {
+      if (bread3_count < MAX_BREAD_PER_TYPE && totalBefore < max_total_breads) {
+        bread3_count++;
+        totalAfter++;
       }
+    }
 
-      step = (step + 1) % 6;
-      vTaskDelay(100 / portTICK_PERIOD_MS);
+    if (totalAfter != totalBefore) {
+      num1 = bread1_count;
+      num2 = bread2_count;
+      num3 = bread3_count;
+      showNumbers(num1, num2, num3);
+    }
+  }
+}
+
+static void handleConfirmPress() {
+  if (!flowIsConfirming() && currentStatus == STATUS_NORMAL) {
+    int totalBread = bread1_count + bread2_count + bread3_count;
+    if (totalBread <= 0) {
+      Serial.println("Confirm button ignored: all bread counts are zero");
     } else {
-      vTaskDelay(50 / portTICK_PERIOD_MS);
+      Serial.println("Confirm button pressed -> entering confirmation mode");
+      // Copies the counts to the baker digits and takes them if free
+      flowDispatch(FLOW_EV_CONFIRM);
+      buzzerPlay(BUZZER_CONFIRM);
     }
   }
 }
 
-void newBreadButtonTask(void* param) {
-  pinMode(NEW_BREAD_BUTTON_PIN, INPUT_PULLUP);
+static void handleNewBreadResult(const NewBreadResponse& r, unsigned long& errorUntil) {
+  if (!r.error.isEmpty()) {
+    setStatus(STATUS_API_ERROR);
+    errorUntil = millis() + 5000;
+    return;
+  }
 
-  int lastReading = HIGH;
-  int stableState = HIGH;
-  unsigned long lastDebounceTime = 0;
-  const unsigned long debounceDelay = 50;
+  // Normal case: response has "customer_breads" with counts
+  if (r.has_customer_breads &&
+      (r.bread_counts[0] > 0 || r.bread_counts[1] > 0 || r.bread_counts[2] > 0)) {
+    // Update cook display counts from customer_breads
+    bread1_cook_display = r.bread_counts[0];
+    bread2_cook_display = r.bread_counts[1];
+    bread3_cook_display = r.bread_counts[2];
+  } else {
+    // No bread left to cook: force '-' on cook display
+    bread1_cook_display = -1;
+    bread2_cook_display = -1;
+    bread3_cook_display = -1;
+  }
 
-  while (1) {
-    // Only accept new-bread events when network and init are ready
-    if (!(init_success && isNetworkReady())) {
-      vTaskDelay(100 / portTICK_PERIOD_MS);
-      continue;
-    }
+  setStatus(STATUS_NORMAL);
+}
 
-    int reading = digitalRead(NEW_BREAD_BUTTON_PIN);
+// Puts the oldest failed order back on the keypad, but only once it is idle:
+// never over counts the cashier is entering or a pending confirmation
+static void restoreFailedOrder() {
+  if (flowIsConfirming() || bread1_count + bread2_count + bread3_count > 0) return;
+
+  OrderRequest order;
+  if (!failedOrderQueue || xQueueReceive(failedOrderQueue, &order, (TickType_t)0) != pdTRUE) return;
+
+  Serial.println("Order " + String(order.seq) + " not submitted, counts back on the keypad");
+  bread1_count = order.counts[0];
+  bread2_count = order.counts[1];
+  bread3_count = order.counts[2];
+  num1 = bread1_count;
+  num2 = bread2_count;
+  num3 = bread3_count;
+  showNumbers(num1, num2, num3);
+}
 
-    if (reading != lastReading) {
-      lastDebounceTime = millis();
-    }
+// Presses while the previous one is still in flight are dropped
+static void handleNewBreadPress() {
+  if (newBreadInFlight) return;
+  // One new bread went to the oven
+  newBreadInFlight = apiNewBreadAsync(&newBreadResult, NULL, postApiDone);
+}
 
-    if ((millis() - lastDebounceTime) > debounceDelay) {
-      if (reading != stableState) {
-        // Detect LOW press (HIGH -> LOW): one new bread went to oven
-        if (stableState == HIGH && reading == LOW) {
-          NewBreadResponse r = apiNewBread();
-
-          if (!r.error.isEmpty()) {
-            setStatus(STATUS_API_ERROR);
-            vTaskDelay(5000 / portTICK_PERIOD_MS);
-            setStatus(STATUS_NORMAL);
-          } else {
-            // Normal case: response has "customer_breads" with counts
-            if (r.has_customer_breads &&
-                (r.bread_counts[0] > 0 || r.bread_counts[1] > 0 || r.bread_counts[2] > 0)) {
-              // Update cook display counts from customer_breads
-              bread1_cook_display = r.bread_counts[0];
-              bread2_cook_display = r.bread_counts[1];
-              bread3_cook_display = r.bread_counts[2];
-            } else {
-              // No bread left to cook: force '-' on cook display
-              bread1_cook_display = -1;
-              bread2_cook_display = -1;
-              bread3_cook_display = -1;
-            }
+// ---------- INPUT HANDLER ----------
+// Every key and button reaction runs here, driven by inputTask's debounced
+// events. API completions are posted to the same queue (postApiDone), so the
+// task sleeps until there is actually something to do.
+void inputHandlerTask(void* param) {
+  InputEvent ev;
 
-            setStatus(STATUS_NORMAL);
-          }
+  while (1) {
+    // Wake for the next error-screen timeout, otherwise only for events
+    TickType_t wait = portMAX_DELAY;
+    if (newBreadErrorUntil != 0) {
+      long left = (long)(newBreadErrorUntil - millis());
+      wait = left > 0 ? left / portTICK_PERIOD_MS : 0;
+    }
+
+    if (inputNextEvent(ev, wait)) {
+      if (ev.type == INPUT_EVENT_API_DONE) {
+        if (ev.key == API_NEW_BREAD) {
+          newBreadInFlight = false;
+          handleNewBreadResult(newBreadResult.new_bread, newBreadErrorUntil);
+        }
+      } else if (ev.type == INPUT_EVENT_ORDER_FAILED) {
+        // Restored below, now or once the keypad is idle
+      } else if (!isInitDone()) {
+        // Only respond to keys once a config is loaded (cached or fetched);
+        // orders queue until the network is there
+      } else if (ev.type == INPUT_EVENT_RELEASE) {
+        if (ev.key < INPUT_KEY_CONFIRM) {
+          Serial.print("Button RELEASED (row,col): ");
+          Serial.print(ev.key / 3);
+          Serial.print(", ");
+          Serial.println(ev.key % 3);
+        }
+      } else if (ev.type == INPUT_EVENT_CHORD) {
+        // The individual presses were already handled; nothing is bound to chords yet
+        Serial.println("Chord: 0x" + String(ev.keys, HEX));
+      } else if (ev.type == INPUT_EVENT_REPEAT) {
+        // Held +/- keeps counting, but only while editing counts
+        if (!flowIsConfirming()) {
+          handleMatrixPress(ev.key / 3, ev.key % 3);
         }
-        stableState = reading;
+      } else if (ev.key == INPUT_KEY_CONFIRM) {
+        handleConfirmPress();
+      } else if (ev.key == INPUT_KEY_NEW_BREAD) {
+        handleNewBreadPress();
+      } else {
+        handleMatrixPress(ev.key / 3, ev.key % 3);
+      }
+
+      if (failedOrderQueue && uxQueueMessagesWaiting(failedOrderQueue) > 0) {
+        restoreFailedOrder();
       }
     }
 
-    lastReading = reading;
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    if (newBreadErrorUntil != 0 && (long)(millis() - newBreadErrorUntil) >= 0) {
+      newBreadErrorUntil = 0;
+      setStatus(STATUS_NORMAL);
+    }
   }
 }
 
@@ -14,14 +14,21 @@ void bakerForceFinish(void* param);
 void sendTimeoutToServerTask(void* param);
 void ticketFlowTask(void* param);
 void scannerTask(void* param);
-void breadButtonsTask(void* param);
-void confirmButtonTask(void* param);
-void confirmAnimationTask(void* param);
-void newBreadButtonTask(void* param);
+void inputHandlerTask(void* param);
+void orderWorkerTask(void* param);
+
+void warmStartFromFlash();
+BootStats getBootStats();
+bool isWarmStartSyncPending();
+
+void initOrderWorker();
+int getOrderQueueDepth();
+void getOrderStats(uint32_t& submitted, uint32_t& failed);
 // void upcomingBreadTask(void* param);
 
-void initDisplayEspNow();
-bool sendCustomerToDisplay(int ticketId);
+void initTicketFlow();
+bool pushCurrentTicketState(const CurrentTicketState& state);
+bool requestTicketFlowPoll();
 
 
 #endif
@@ -2,7 +2,6 @@
 #define TYPES_H
 
 #include <vector>
-#include <deque>
 #include <Arduino.h>
 
 // ---------- DISPLAY STATE ----------
@@ -17,11 +16,40 @@ enum DeviceStatus : uint8_t {
   STATUS_INIT
 };
 
-// ---------- MQTT MESSAGE STRUCTURE ----------
-struct MqttMessage {
-  String topic;
-  String payload;
-  bool retain;
+// ---------- NETWORK TASK COMMANDS ----------
+enum NetCommandType : uint8_t {
+  NET_CMD_FLUSH,           // flush the outbound MQTT ring now
+  NET_CMD_RECONNECT_MQTT,  // drop and re-establish the broker session
+  NET_CMD_REBOOT           // flush, then ESP.restart()
+};
+
+struct NetCommand {
+  NetCommandType type;
+};
+
+// ---------- MQTT OUTBOUND QUEUE ----------
+// Outbound messages reference their topic by id so ring slots stay fixed-size
+enum MqttTopicId : uint8_t {
+  MQTT_TOPIC_ERROR,
+  MQTT_TOPIC_BREAD_TIME,
+  MQTT_TOPIC_STATS
+};
+
+struct MqttQueueStats {
+  uint32_t enqueued = 0;
+  uint32_t published = 0;
+  uint32_t dropped = 0;         // ring full, message rejected (drop-newest)
+  uint32_t truncated = 0;       // payload cut to MQTT_SLOT_PAYLOAD_SIZE - 1
+  uint32_t high_water = 0;      // most messages drained in one flush
+  uint32_t enqueue_avg_cycles = 0;  // CPU cycles per queueMqttMessage call
+  uint32_t enqueue_max_cycles = 0;
+  uint32_t publish_calls = 0;          // PUBLISH packets sent (stats window)
+  uint32_t publish_failed = 0;         // PUBLISH attempts that failed (stats window)
+  uint32_t publish_abandoned = 0;      // messages given up after MQTT_PUBLISH_ATTEMPTS (stats window)
+  uint32_t msgs_per_publish_x100 = 0;  // messages per PUBLISH, x100 (stats window)
+  uint32_t flush_latency_avg_ms = 0;   // oldest message age at flush (stats window)
+  uint32_t flush_latency_max_ms = 0;
+  uint32_t flush_window_ms = 0;        // current adaptive flush window
 };
 
 // ---------- API RESPONSE STRUCTURES ----------
@@ -34,7 +62,8 @@ struct ServeTicketResponse {
   String error;
 };
 
-struct CurrentTicketResponse {
+// Plain current-ticket state, shared by the HTTP poll and the MQTT push
+struct CurrentTicketState {
   bool ready = false;
   int wait_until = -1;
   bool has_customer_in_queue = true;
@@ -42,9 +71,23 @@ struct CurrentTicketResponse {
   int breads[MAX_KEYS];
   int bread_counts[MAX_KEYS];
   int bread_count = 0;
+};
+
+struct CurrentTicketResponse : CurrentTicketState {
   String error;
 };
 
+// Items consumed by ticketFlowTask
+enum TicketFlowEventType : uint8_t {
+  TICKET_EVENT_STATE,  // full current-ticket state pushed over MQTT
+  TICKET_EVENT_POLL    // ask the server over HTTP now
+};
+
+struct TicketFlowEvent {
+  TicketFlowEventType type;
+  CurrentTicketState state;
+};
+
 struct NewBreadResponse {
   bool has_customer_breads = false;  // true when "customer_breads" is present
   int bread_index = -1;
@@ -64,9 +107,271 @@ struct NewBreadResponse {
 // };
 
 
+// ---------- ASYNC API REQUESTS ----------
+enum ApiRequestType : uint8_t {
+  API_NEW_CUSTOMER,
+  API_SERVE_TICKET,
+  API_NEW_BREAD,
+  API_CURRENT_TICKET
+};
+
+struct ApiResult {
+  ApiRequestType type = API_NEW_CUSTOMER;
+  int customer_ticket_id = -1;   // API_NEW_CUSTOMER, -1 on failure
+  bool show_on_display = false;  // API_NEW_CUSTOMER
+  ServeTicketResponse serve;
+  CurrentTicketResponse current;
+  NewBreadResponse new_bread;
+};
+
+typedef void (*ApiCallback)(ApiResult& result, void* ctx);
+
+// Plain data so it can be copied through a FreeRTOS queue
+struct ApiRequest {
+  ApiRequestType type = API_NEW_CUSTOMER;
+  int ticket_id = -1;
+  int breads[MAX_KEYS];
+  int bread_count = 0;
+  ApiResult* result = NULL;         // filled before completion is signalled
+  TaskHandle_t notify_task = NULL;  // receives xTaskNotifyGive on completion
+  ApiCallback callback = NULL;      // runs on the API worker task
+  void* ctx = NULL;
+};
+
 struct HttpResponse {
   int status_code;
   String body;
 };
 
+// ---------- API HEAP STATS ----------
+struct ApiHeapStats {
+  uint32_t calls = 0;
+  uint32_t last_bytes = 0;  // heap held by the last call at parse time
+  uint32_t max_bytes = 0;
+};
+
+// ---------- HTTP SESSION STATS ----------
+struct HttpSessionStats {
+  uint32_t requests = 0;    // every request put on the wire
+  uint32_t reused = 0;      // requests served over an already open socket
+  uint32_t reconnects = 0;  // reused sockets found stale and reopened
+};
+
+// ---------- ORDER SUBMISSION ----------
+struct OrderRequest {
+  uint32_t seq;       // accept order, also the error detail on failure
+  int counts[3];      // bread1..3 as confirmed by the baker
+};
+
+// ---------- INPUT EVENTS ----------
+// Keys: matrix (row * 3 + col), then the two standalone buttons
+#define INPUT_KEY_MATRIX(row, col) ((row) * 3 + (col))
+#define INPUT_KEY_CONFIRM    9
+#define INPUT_KEY_NEW_BREAD  10
+#define INPUT_KEY_COUNT      11
+
+enum InputEventType : uint8_t {
+  INPUT_EVENT_PRESS,
+  INPUT_EVENT_RELEASE,
+  INPUT_EVENT_REPEAT,    // +/- key still held on its own
+  INPUT_EVENT_CHORD,     // key went down while others were held; see keys
+  INPUT_EVENT_API_DONE,  // key = ApiRequestType of the finished request
+  INPUT_EVENT_ORDER_FAILED  // an accepted order could not be submitted; see restoreFailedOrder()
+};
+
+struct InputEvent {
+  InputEventType type;
+  uint8_t key;
+  uint16_t keys;      // debounced state of every key, 1 bit per INPUT_KEY_*
+  uint32_t edge_us;   // first GPIO edge behind this event (esp_timer clock)
+  uint32_t at_us;     // when the debounced event was published
+};
+
+struct InputStats {
+  uint32_t events = 0;
+  uint32_t wakeups = 0;          // scanner wakeups (edge or active scan tick)
+  uint32_t latency_avg_us = 0;   // edge -> published event
+  uint32_t latency_max_us = 0;
+  uint32_t scan_avg_cycles = 0;  // one readKeys() + debounce pass
+  uint32_t scan_max_cycles = 0;
+};
+
+// ---------- QR SCANNER ----------
+struct ScanTicket {
+  int ticket_id;
+  uint32_t rx_us;       // first byte of the code arrived
+};
+
+// What the server last said about a scanned ticket
+enum TicketVerdict : uint8_t {
+  TICKET_UNKNOWN,
+  TICKET_SERVED,
+  TICKET_NOT_IN_WAIT_LIST
+};
+
+struct ScannerStats {
+  uint32_t scans = 0;            // codes handed to scannerTask
+  uint32_t other_bakery = 0;     // valid codes for another bakery, rejected
+  uint32_t malformed = 0;        // lines without a usable t= (or too long)
+  uint32_t dropped = 0;          // ticket queue full
+  uint32_t served = 0;
+  uint32_t submit_avg_us = 0;    // first byte -> serve request submitted
+  uint32_t submit_max_us = 0;
+  uint32_t result_avg_ms = 0;    // first byte -> serve result back
+  uint32_t result_max_ms = 0;
+  uint32_t cache_hits = 0;       // duplicate scans answered locally
+  uint32_t cache_misses = 0;
+};
+
+// ---------- PRINTER JOBS ----------
+enum PrinterJobType : uint8_t {
+  PRINTER_JOB_BEGIN,   // static ticket header, sent while the ticket id is still unknown
+  PRINTER_JOB_FINISH,  // id + QR, completes a begun ticket
+  PRINTER_JOB_TICKET,  // header + id + QR in one go
+  PRINTER_JOB_VOID     // closes off a begun ticket whose request failed
+};
+
+struct PrinterJob {
+  PrinterJobType type;
+  int bakery_id;
+  int ticket_id;
+};
+
+struct PrinterStats {
+  uint32_t tickets = 0;        // completed tickets (FINISH / TICKET)
+  uint32_t voided = 0;
+  uint32_t dropped = 0;        // queue full
+  uint32_t bytes = 0;
+  uint32_t busy_ms = 0;        // time spent writing to the printer UART
+  uint32_t capacity_tpm = 0;   // tickets/min the link sustains at that cost
+};
+
+// ---------- CUSTOMER DISPLAY FRAMES (ESP-NOW) ----------
+// Wire format shared with the customer display firmware. Little endian,
+// packed: a header followed by `count` updates. A display that supports it
+// answers every TICKETS frame with an ACK frame carrying the same seq and
+// count = 0; the first such ACK switches the sender to retransmitting.
+#define DISPLAY_FRAME_VERSION 1
+
+enum DisplayFrameType : uint8_t {
+  DISPLAY_FRAME_TICKETS = 1,
+  DISPLAY_FRAME_ACK     = 2
+};
+
+enum DisplayUpdateKind : uint8_t {
+  DISPLAY_UPDATE_CALL    = 1,  // call this customer now (an event; resent until acked once the display ACKs; overflow is reported)
+  DISPLAY_UPDATE_WAITING = 2   // ready and in the wait list (state, in every frame; a change sends one)
+};
+
+struct __attribute__((packed)) DisplayFrameHeader {
+  uint8_t version;
+  uint8_t type;
+  uint16_t seq;
+  uint8_t count;
+};
+
+struct __attribute__((packed)) DisplayTicketUpdate {
+  uint8_t kind;
+  int32_t ticket_id;
+};
+
+struct CustomerDisplayStats {
+  uint32_t frames = 0;        // first transmissions
+  uint32_t retransmits = 0;
+  uint32_t acks = 0;
+  uint32_t send_fail = 0;     // esp_now_send error or send callback FAIL
+  uint32_t calls_dropped = 0; // call queue overflow
+  uint32_t ack_avg_ms = 0;    // first transmission -> ACK
+  uint32_t ack_max_ms = 0;
+};
+
+// ---------- BOOT ----------
+struct BootStats {
+  bool warm = false;          // started from the init data cached in NVS
+  uint32_t ready_ms = 0;      // boot -> keypad accepting orders, 0 = not yet
+  uint32_t synced_ms = 0;     // boot -> fresh /hardware_init applied, 0 = not yet
+};
+
+// ---------- BUZZER ----------
+enum BuzzerPattern : uint8_t {
+  BUZZER_SUCCESS,     // ticket served, delivery shown
+  BUZZER_REJECTED,    // ticket not in the wait list
+  BUZZER_DUPLICATE,   // re-scan of a ticket just served
+  BUZZER_ERROR,       // serve failed for any other reason
+  BUZZER_CONFIRM      // confirmation mode entered
+};
+
+struct BuzzerStats {
+  uint32_t played = 0;
+  uint32_t preempted = 0;   // a playing pattern was cut short
+  uint32_t ignored = 0;     // lower priority than what was playing
+};
+
+// ---------- WAIT-LIST MIRROR ----------
+struct WaitListEntry {
+  int ticket_id = -1;
+  int bread_counts[3] = {0, 0, 0};  // delivery display slots, as serve_ticket maps them
+  unsigned long added = 0;
+};
+
+struct WaitListStats {
+  uint32_t size = 0;
+  uint32_t deltas = 0;        // MQTT wait_list_update messages applied
+  uint32_t hits = 0;          // scans shown before the server answered
+  uint32_t corrections = 0;   // server confirmed with different counts
+  uint32_t reverts = 0;       // server rejected a ticket the mirror had
+};
+
+// ---------- DISPLAY INTENTS ----------
+enum DisplayIntent : uint8_t {
+  DISPLAY_INTENT_STATUS,        // full redraw for currentStatus
+  DISPLAY_INTENT_NUMBERS,       // customer digits 0,0 / 0,2 / 0,3
+  DISPLAY_INTENT_OWNER_COUNTS,  // baker digits 1,6 / 1,4 / 1,3
+  DISPLAY_INTENT_DELIVERY,      // delivery digits 1,0 / 1,5 / 1,1
+  DISPLAY_INTENT_COOK,          // cook digits 1,2 / 1,7 / 0,4
+  DISPLAY_INTENT_CONFIRM_ANIM,  // (re)check confirm animation
+  DISPLAY_INTENT_CHAR           // single char on 0,0
+};
+
+struct DisplayCommand {
+  DisplayIntent intent;
+  char ch;
+  int a, b, c;
+};
+
+// ---------- DISPLAY STATS ----------
+struct DisplayStats {
+  uint32_t bytes_per_sec = 0;        // bytes actually clocked into the chain
+  uint32_t naive_bytes_per_sec = 0;  // what LedControl would have clocked for the same calls
+  uint32_t flushes = 0;
+  uint32_t transactions = 0;         // CS frames (bit-banged or SPI)
+  uint32_t digits_written = 0;
+  uint32_t intents = 0;              // display calls made by other tasks
+  uint32_t frames = 0;               // frames the render task drew for them
+};
+
+// ---------- ORDER / DELIVERY FLOW ----------
+// State bits of the flow machine (flow.cpp); the display mode rides along
+#define FLOW_CONFIRMING  0x01  // baker is confirming the keypad counts
+#define FLOW_UPLOADING   0x02  // accepted orders queued or in flight
+#define FLOW_DELIVERY    0x04  // served ticket waiting for baker accept
+
+enum FlowEvent : uint8_t {
+  FLOW_EV_CONFIRM,         // confirm button with a non-empty order
+  FLOW_EV_ACCEPT,          // baker accepted, order queued
+  FLOW_EV_REJECT,          // baker rejected
+  FLOW_EV_ORDERS_DRAINED,  // order worker finished the last queued order
+  FLOW_EV_DELIVERY,        // ticket served, delivery counts set
+  FLOW_EV_DELIVERY_DONE,   // baker accepted the shown delivery
+  FLOW_EV_DELIVERY_CANCEL  // server rejected a delivery shown ahead of its answer
+};
+
+struct FlowLogEntry {
+  uint32_t ms;
+  FlowEvent event;
+  uint8_t from;       // state bits | display mode << 4
+  uint8_t to;
+  bool accepted;
+};
+
 #endif
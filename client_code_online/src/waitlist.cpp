@@ -0,0 +1,179 @@
+#include "waitlist.h"
+
+// Written by ticketFlowTask (send_current_ticket_to_wait_list), networkTask
+// (MQTT deltas) and scannerTask (scans); every access is a short copy under
+// waitListMux.
+static portMUX_TYPE waitListMux = portMUX_INITIALIZER_UNLOCKED;
+static WaitListEntry waitList[WAIT_LIST_MIRROR_SIZE];
+static WaitListStats waitListStats;
+static void (*waitListChanged)() = NULL;
+
+void waitListOnChange(void (*handler)()) {
+  waitListChanged = handler;
+}
+
+static void notifyChanged() {
+  if (waitListChanged) waitListChanged();
+}
+
+static bool entryExpired(const WaitListEntry& e, unsigned long now) {
+  return e.ticket_id < 0 || now - e.added > WAIT_LIST_TTL_MS;
+}
+
+void waitListAdd(int ticketId, const int* breadCounts, int count) {
+  if (ticketId < 0) return;
+  unsigned long now = millis();
+
+  portENTER_CRITICAL(&waitListMux);
+  // Same ticket, else a free or expired slot, else the oldest entry
+  WaitListEntry* slot = NULL;
+  for (int i = 0; i < WAIT_LIST_MIRROR_SIZE && !slot; i++) {
+    if (waitList[i].ticket_id == ticketId) slot = &waitList[i];
+  }
+  for (int i = 0; i < WAIT_LIST_MIRROR_SIZE && !slot; i++) {
+    if (entryExpired(waitList[i], now)) slot = &waitList[i];
+  }
+  if (!slot) {
+    slot = &waitList[0];
+    for (int i = 1; i < WAIT_LIST_MIRROR_SIZE; i++) {
+      if (now - waitList[i].added > now - slot->added) slot = &waitList[i];
+    }
+  }
+
+  slot->ticket_id = ticketId;
+  for (int i = 0; i < 3; i++) {
+    slot->bread_counts[i] = i < count ? breadCounts[i] : 0;
+  }
+  slot->added = now;
+  portEXIT_CRITICAL(&waitListMux);
+  notifyChanged();
+}
+
+void waitListRemove(int ticketId) {
+  portENTER_CRITICAL(&waitListMux);
+  for (int i = 0; i < WAIT_LIST_MIRROR_SIZE; i++) {
+    if (waitList[i].ticket_id == ticketId) waitList[i].ticket_id = -1;
+  }
+  portEXIT_CRITICAL(&waitListMux);
+  notifyChanged();
+}
+
+void waitListClear() {
+  portENTER_CRITICAL(&waitListMux);
+  for (int i = 0; i < WAIT_LIST_MIRROR_SIZE; i++) {
+    waitList[i].ticket_id = -1;
+  }
+  portEXIT_CRITICAL(&waitListMux);
+  notifyChanged();
+}
+
+bool waitListContains(int ticketId) {
+  unsigned long now = millis();
+  bool found = false;
+
+  portENTER_CRITICAL(&waitListMux);
+  for (int i = 0; i < WAIT_LIST_MIRROR_SIZE && !found; i++) {
+    found = waitList[i].ticket_id == ticketId && !entryExpired(waitList[i], now);
+  }
+  portEXIT_CRITICAL(&waitListMux);
+  return found;
+}
+
+bool waitListTake(int ticketId, int breadCounts[3]) {
+  unsigned long now = millis();
+  bool hit = false;
+
+  portENTER_CRITICAL(&waitListMux);
+  for (int i = 0; i < WAIT_LIST_MIRROR_SIZE; i++) {
+    WaitListEntry& e = waitList[i];
+    if (e.ticket_id == ticketId && !entryExpired(e, now)) {
+      for (int j = 0; j < 3; j++) breadCounts[j] = e.bread_counts[j];
+      e.ticket_id = -1;
+      waitListStats.hits++;
+      hit = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&waitListMux);
+  if (hit) notifyChanged();
+  return hit;
+}
+
+int waitListSnapshot(int* ticketIds, int max) {
+  unsigned long now = millis();
+  WaitListEntry live[WAIT_LIST_MIRROR_SIZE];
+  int n = 0;
+
+  portENTER_CRITICAL(&waitListMux);
+  for (int i = 0; i < WAIT_LIST_MIRROR_SIZE; i++) {
+    if (!entryExpired(waitList[i], now)) live[n++] = waitList[i];
+  }
+  portEXIT_CRITICAL(&waitListMux);
+
+  // Insertion sort by age; n is tiny
+  for (int i = 1; i < n; i++) {
+    WaitListEntry e = live[i];
+    int j = i - 1;
+    while (j >= 0 && (long)(live[j].added - e.added) > 0) {
+      live[j + 1] = live[j];
+      j--;
+    }
+    live[j + 1] = e;
+  }
+
+  int count = n < max ? n : max;
+  for (int i = 0; i < count; i++) ticketIds[i] = live[i].ticket_id;
+  return count;
+}
+
+bool waitListApplyDelta(JsonVariantConst doc) {
+  const char* op = doc["op"] | "";
+  int ticketId = doc["ticket_id"] | -1;
+
+  if (!strcmp(op, "add") && ticketId >= 0) {
+    int counts[MAX_KEYS];
+    int n = 0;
+    JsonObjectConst detail = doc["user_detail"].as<JsonObjectConst>();
+    for (JsonPairConst kv : detail) {
+      if (n < MAX_KEYS) counts[n++] = kv.value().as<int>();
+    }
+    waitListAdd(ticketId, counts, n);
+  } else if (!strcmp(op, "remove") && ticketId >= 0) {
+    waitListRemove(ticketId);
+  } else if (!strcmp(op, "clear")) {
+    waitListClear();
+  } else {
+    return false;
+  }
+
+  portENTER_CRITICAL(&waitListMux);
+  waitListStats.deltas++;
+  portEXIT_CRITICAL(&waitListMux);
+  return true;
+}
+
+void waitListRecordCorrection() {
+  portENTER_CRITICAL(&waitListMux);
+  waitListStats.corrections++;
+  portEXIT_CRITICAL(&waitListMux);
+}
+
+void waitListRecordRevert() {
+  portENTER_CRITICAL(&waitListMux);
+  waitListStats.reverts++;
+  portEXIT_CRITICAL(&waitListMux);
+}
+
+WaitListStats getWaitListStats() {
+  unsigned long now = millis();
+
+  portENTER_CRITICAL(&waitListMux);
+  WaitListStats st = waitListStats;
+  st.size = 0;
+  for (int i = 0; i < WAIT_LIST_MIRROR_SIZE; i++) {
+    if (!entryExpired(waitList[i], now)) st.size++;
+  }
+  waitListStats = WaitListStats();
+  portEXIT_CRITICAL(&waitListMux);
+  return st;
+}
@@ -0,0 +1,29 @@
+#ifndef WAITLIST_H
+#define WAITLIST_H
+
+#include <ArduinoJson.h>
+#include "config.h"
+#include "types.h"
+
+// ---------- WAIT-LIST MIRROR ----------
+// Local copy of the tickets currently in this bakery's wait list and their
+// bread counts, so a scan can be shown before serve_ticket answers
+void waitListAdd(int ticketId, const int* breadCounts, int count);
+void waitListRemove(int ticketId);
+void waitListClear();
+bool waitListContains(int ticketId);
+bool waitListTake(int ticketId, int breadCounts[3]);   // removes it on a hit
+int waitListSnapshot(int* ticketIds, int max);          // oldest first
+
+// Called after every add, remove, take or clear, outside the mux
+void waitListOnChange(void (*handler)());
+
+// {"op":"add","ticket_id":N,"user_detail":{"<bread_id>":count,...}},
+// {"op":"remove","ticket_id":N} or {"op":"clear"}
+bool waitListApplyDelta(JsonVariantConst doc);
+
+void waitListRecordCorrection();
+void waitListRecordRevert();
+WaitListStats getWaitListStats();
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// ---------- HOST ARDUINO ----------
+// Just enough of the ESP32 Arduino core to build the pure-logic modules on
+// the host. Time is a fake clock the tests advance (host.h); pins, SPI and
+// the UARTs are recorded instead of driven.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+#include <algorithm>
+#include "freertos_host.h"
+
+#define IRAM_ATTR
+#define WORD_ALIGNED_ATTR __attribute__((aligned(4)))
+
+#define HIGH 1
+#define LOW  0
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+#define CHANGE   3
+#define FALLING  2
+#define RISING   1
+#define MSBFIRST 1
+#define SERIAL_8N1 0x800001c
+
+#define BIT0 (1u << 0)
+#define BIT1 (1u << 1)
+#define BIT2 (1u << 2)
+#define BIT3 (1u << 3)
+#define BIT4 (1u << 4)
+
+typedef uint8_t byte;
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+void shiftOut(int dataPin, int clockPin, int bitOrder, uint8_t value);
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(int pin, void (*isr)(), int mode);
+
+class String {
+ public:
+  String() {}
+  String(const char* s) : s(s ? s : "") {}
+  String(const std::string& s) : s(s) {}
+  String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned int v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+
+  const char* c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.size(); }
+  long toInt() const { return strtol(s.c_str(), NULL, 10); }
+  bool equals(const String& o) const { return s == o.s; }
+  bool equalsIgnoreCase(const String& o) const {
+    return s.size() == o.s.size() && strcasecmp(s.c_str(), o.s.c_str()) == 0;
+  }
+  bool startsWith(const String& o) const { return s.compare(0, o.s.size(), o.s) == 0; }
+  int indexOf(char c) const { size_t i = s.find(c); return i == std::string::npos ? -1 : (int)i; }
+  String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < s.size() && to > from ? String(s.substr(from, to - from)) : String();
+  }
+  char operator[](unsigned int i) const { return i < s.size() ? s[i] : 0; }
+
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  String& operator+=(const char* o) { s += o; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+  friend String operator+(const String& a, const char* b) { return String(a.s + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.s); }
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == o; }
+  bool operator!=(const String& o) const { return s != o.s; }
+
+ private:
+  std::string s;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (len--) n += write(*buf++);
+    return n;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(int v) { return print(String(v)); }
+  size_t print(unsigned long v) { return print(String(v)); }
+  size_t println() { return write("\r\n"); }
+  template<class T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long ms) { timeout = ms; }
+  // Host streams never block: a byte is either there or the read times out
+  size_t readBytes(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+      int c = read();
+      if (c < 0) break;
+      buf[n++] = (uint8_t)c;
+    }
+    return n;
+  }
+  size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t*)buf, len); }
+
+ protected:
+  unsigned long timeout = 1000;
+};
+
+struct EspClass {
+  uint32_t getCycleCount();
+  uint32_t getFreeHeap();
+  void restart();
+};
+extern EspClass ESP;
+
+#include "HardwareSerial.h"
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef HOST_HARDWARESERIAL_H
+#define HOST_HARDWARESERIAL_H
+
+#include "Arduino.h"
+#include <functional>
+#include <string>
+
+// A UART sink: everything written is kept in `output`. flush() charges the
+// fake clock for the bytes written since the last flush at the configured
+// baud rate (10 bits per byte), so throughput can be measured on the host.
+class HardwareSerial : public Stream {
+ public:
+  explicit HardwareSerial(int num) : num(num) {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int rx = -1, int tx = -1) {
+    this->baud = baud;
+  }
+  void end() {}
+
+  size_t write(uint8_t c) override {
+    output.push_back((char)c);
+    unflushed++;
+    return 1;
+  }
+  size_t write(const uint8_t* buf, size_t len) override {
+    output.append((const char*)buf, len);
+    unflushed += len;
+    writeCalls++;
+    return len;
+  }
+  using Print::write;
+
+  void flush();
+
+  int available() override { return (int)(input.size() - inputPos); }
+  int read() override { return inputPos < input.size() ? (uint8_t)input[inputPos++] : -1; }
+  int peek() override { return inputPos < input.size() ? (uint8_t)input[inputPos] : -1; }
+
+  void setRxTimeout(uint8_t symbols) { rxTimeout = symbols; }
+  void onReceive(std::function<void()> cb, bool onlyOnTimeout = false) {
+    receiveCb = cb;
+    receiveOnTimeout = onlyOnTimeout;
+  }
+
+  // Test side: bytes arriving from the peer, then the RX callback the UART
+  // driver would raise (FIFO full or RX timeout)
+  void inject(const std::string& bytes) { input.append(bytes); }
+  void raiseReceive() { if (receiveCb) receiveCb(); }
+
+  int num;
+  unsigned long baud = 115200;
+  std::string output;
+  size_t unflushed = 0;
+  uint32_t writeCalls = 0;
+  std::string input;
+  size_t inputPos = 0;
+  std::function<void()> receiveCb;
+  bool receiveOnTimeout = false;
+  uint8_t rxTimeout = 2;
+};
+
+extern HardwareSerial Serial;
+
+#endif
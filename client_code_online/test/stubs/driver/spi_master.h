@@ -0,0 +1,45 @@
+#ifndef HOST_SPI_MASTER_H
+#define HOST_SPI_MASTER_H
+
+#include <Arduino.h>
+#include <functional>
+
+// Transactions complete as soon as they are queued; each one is reported
+// to hostOnSpiTransaction with its tx bytes
+typedef int spi_host_device_t;
+#define VSPI_HOST 2
+#define SPI_DMA_CH_AUTO 3
+
+struct spi_bus_config_t {
+  int mosi_io_num;
+  int miso_io_num;
+  int sclk_io_num;
+  int quadwp_io_num;
+  int quadhd_io_num;
+  int max_transfer_sz;
+};
+
+struct spi_device_interface_config_t {
+  uint8_t mode;
+  int clock_speed_hz;
+  int spics_io_num;
+  int queue_size;
+};
+
+struct spi_transaction_t {
+  uint32_t flags;
+  size_t length;  // bits
+  const void* tx_buffer;
+  void* rx_buffer;
+};
+
+typedef struct HostSpiDevice* spi_device_handle_t;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* bus, int dma);
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* dev, spi_device_handle_t* handle);
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans, TickType_t wait);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans, TickType_t wait);
+
+extern std::function<void(const uint8_t* tx, size_t len)> hostOnSpiTransaction;
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// ---------- HOST FREERTOS ----------
+// Queues, semaphores, event groups, task notifications and tasks on top of
+// std::thread. Every blocking call waits on the fake clock, so a test drives
+// time with hostAdvance() and sees a settled system after hostSettle().
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t EventBits_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define pdFAIL  0
+#define errQUEUE_FULL 0
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR()
+#define tskNO_AFFINITY -1
+
+struct portMUX_TYPE {
+  std::mutex m;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux)     ((mux)->m.lock())
+#define portEXIT_CRITICAL(mux)      ((mux)->m.unlock())
+#define portENTER_CRITICAL_ISR(mux) ((mux)->m.lock())
+#define portEXIT_CRITICAL_ISR(mux)  ((mux)->m.unlock())
+
+struct HostQueue;
+struct HostEventGroup;
+struct HostTask;
+typedef HostQueue* QueueHandle_t;
+typedef HostQueue* SemaphoreHandle_t;
+typedef HostEventGroup* EventGroupHandle_t;
+typedef HostTask* TaskHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait);
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void* item, TickType_t wait);
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t wait);
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken);
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait);
+BaseType_t xQueuePeek(QueueHandle_t q, void* item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q);
+BaseType_t xQueueReset(QueueHandle_t q);
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s);
+
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitAll, TickType_t wait);
+
+enum eNotifyAction { eNoAction, eSetBits, eIncrement, eSetValueWithOverwrite };
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                                   UBaseType_t prio, TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                       UBaseType_t prio, TaskHandle_t* handle);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* woken);
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t wait);
+
+#endif
@@ -0,0 +1,437 @@
+#include "host.h"
+#include <esp_timer.h>
+#include <soc/gpio_reg.h>
+#include <driver/spi_master.h>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <new>
+#include <thread>
+#include <vector>
+
+// ---------- SCHEDULER ----------
+// One lock and one condition variable cover every host RTOS object. A task
+// parks in hostWait() with a readiness predicate; hostSettle() returns once
+// every task is parked and none of the predicates hold.
+struct HostTask {
+  const char* name = "main";
+  bool waiting = false;
+  std::function<bool()> ready;
+  uint32_t notifyValue = 0;
+  bool notifyPending = false;
+};
+
+static std::mutex hostLock;
+static std::condition_variable hostCv;
+static std::atomic<unsigned long> hostNow(0);
+static std::vector<HostTask*> hostTasks;
+static HostTask hostMainTask;
+static thread_local HostTask* hostCurrentTask = NULL;
+
+static bool hostWait(std::unique_lock<std::mutex>& lk, const std::function<bool()>& pred, TickType_t wait) {
+  if (pred()) return true;
+  if (wait == 0) return false;
+  unsigned long deadline = wait == portMAX_DELAY ? ULONG_MAX : hostNow.load() + wait;
+
+  HostTask* self = hostCurrentTask;
+  if (!self) {
+    // The test thread owns the clock, so it moves time forward itself
+    while (!pred() && hostNow.load() < deadline) {
+      lk.unlock();
+      hostAdvance(1);
+      lk.lock();
+    }
+    return pred();
+  }
+
+  self->ready = [&]() { return pred() || hostNow.load() >= deadline; };
+  self->waiting = true;
+  hostCv.notify_all();
+  hostCv.wait(lk, self->ready);
+  self->waiting = false;
+  return pred();
+}
+
+static bool hostAllParked() {
+  for (HostTask* t : hostTasks) {
+    if (!t->waiting || t->ready()) return false;
+  }
+  return true;
+}
+
+void hostSettle() {
+  std::unique_lock<std::mutex> lk(hostLock);
+  hostCv.wait(lk, hostAllParked);
+}
+
+void hostAdvance(unsigned long ms) {
+  hostSettle();
+  for (unsigned long i = 0; i < ms; i++) {
+    {
+      std::lock_guard<std::mutex> lk(hostLock);
+      hostNow++;
+    }
+    hostCv.notify_all();
+    hostSettle();
+  }
+}
+
+// ---------- TIME ----------
+static unsigned long hostMicrosPerMilli = 1000;
+
+void hostSetMicrosPerMilli(unsigned long us) {
+  hostMicrosPerMilli = us;
+}
+
+unsigned long millis() {
+  return hostNow.load();
+}
+
+unsigned long micros() {
+  return hostNow.load() * hostMicrosPerMilli;
+}
+
+int64_t esp_timer_get_time() {
+  return (int64_t)micros();
+}
+
+void delay(uint32_t ms) {
+  vTaskDelay(ms);
+}
+
+void delayMicroseconds(uint32_t us) {}
+
+// ---------- QUEUES AND SEMAPHORES ----------
+struct HostQueue {
+  size_t itemSize;
+  size_t length;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HostQueue* q = new HostQueue();
+  q->itemSize = itemSize;
+  q->length = length;
+  return q;
+}
+
+static BaseType_t hostQueuePut(QueueHandle_t q, const void* item, TickType_t wait, bool front) {
+  std::unique_lock<std::mutex> lk(hostLock);
+  if (!hostWait(lk, [q]() { return q->items.size() < q->length; }, wait)) return errQUEUE_FULL;
+  std::vector<uint8_t> bytes((const uint8_t*)item, (const uint8_t*)item + q->itemSize);
+  if (front) q->items.push_front(bytes);
+  else q->items.push_back(bytes);
+  hostCv.notify_all();
+  return pdTRUE;
+}
+
+static BaseType_t hostQueueGet(QueueHandle_t q, void* item, TickType_t wait, bool remove) {
+  std::unique_lock<std::mutex> lk(hostLock);
+  if (!hostWait(lk, [q]() { return !q->items.empty(); }, wait)) return pdFALSE;
+  if (q->itemSize) memcpy(item, q->items.front().data(), q->itemSize);
+  if (remove) q->items.pop_front();
+  hostCv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait) { return hostQueuePut(q, item, wait, false); }
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void* item, TickType_t wait) { return hostQueuePut(q, item, wait, false); }
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t wait) { return hostQueuePut(q, item, wait, true); }
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken) { return hostQueuePut(q, item, 0, false); }
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait) { return hostQueueGet(q, item, wait, true); }
+BaseType_t xQueuePeek(QueueHandle_t q, void* item, TickType_t wait) { return hostQueueGet(q, item, wait, false); }
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> lk(hostLock);
+  return q->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q) {
+  std::lock_guard<std::mutex> lk(hostLock);
+  return q->length - q->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t q) {
+  std::lock_guard<std::mutex> lk(hostLock);
+  q->items.clear();
+  hostCv.notify_all();
+  return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+  HostQueue* q = xQueueCreate(max, 0);
+  for (UBaseType_t i = 0; i < initial; i++) q->items.emplace_back();
+  return q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return xSemaphoreCreateCounting(1, 1); }
+SemaphoreHandle_t xSemaphoreCreateBinary() { return xSemaphoreCreateCounting(1, 0); }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { return hostQueueGet(s, NULL, wait, true); }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return hostQueuePut(s, NULL, 0, false); }
+
+// ---------- EVENT GROUPS ----------
+struct HostEventGroup {
+  EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreate() {
+  return new HostEventGroup();
+}
+
+std::function<void()> hostOnEventGroupWrite;
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits) {
+  if (hostOnEventGroupWrite) hostOnEventGroupWrite();
+  std::lock_guard<std::mutex> lk(hostLock);
+  g->bits |= bits;
+  hostCv.notify_all();
+  return g->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits) {
+  if (hostOnEventGroupWrite) hostOnEventGroupWrite();
+  std::lock_guard<std::mutex> lk(hostLock);
+  EventBits_t before = g->bits;
+  g->bits &= ~bits;
+  return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g) {
+  std::lock_guard<std::mutex> lk(hostLock);
+  return g->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitAll, TickType_t wait) {
+  std::unique_lock<std::mutex> lk(hostLock);
+  auto met = [g, bits, waitAll]() { return waitAll ? (g->bits & bits) == bits : (g->bits & bits) != 0; };
+  bool ok = hostWait(lk, met, wait);
+  EventBits_t value = g->bits;
+  if (ok && clearOnExit) g->bits &= ~bits;
+  return value;
+}
+
+// ---------- TASKS ----------
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                                   UBaseType_t prio, TaskHandle_t* handle, BaseType_t core) {
+  HostTask* task = new HostTask();
+  task->name = name;
+  {
+    std::lock_guard<std::mutex> lk(hostLock);
+    hostTasks.push_back(task);
+  }
+  if (handle) *handle = task;
+
+  std::thread([fn, param, task]() {
+    hostCurrentTask = task;
+    fn(param);
+    // A returning task is parked for good
+    std::unique_lock<std::mutex> lk(hostLock);
+    task->ready = []() { return false; };
+    task->waiting = true;
+    hostCv.notify_all();
+    hostCv.wait(lk, []() { return false; });
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                       UBaseType_t prio, TaskHandle_t* handle) {
+  return xTaskCreatePinnedToCore(fn, name, stack, param, prio, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return hostCurrentTask ? hostCurrentTask : &hostMainTask;
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)hostNow.load();
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::unique_lock<std::mutex> lk(hostLock);
+  hostWait(lk, []() { return false; }, ticks ? ticks : 1);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait) {
+  HostTask* self = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lk(hostLock);
+  hostWait(lk, [self]() { return self->notifyValue != 0; }, wait);
+  uint32_t value = self->notifyValue;
+  if (value) self->notifyValue = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+  if (!task) return pdFAIL;
+  std::lock_guard<std::mutex> lk(hostLock);
+  switch (action) {
+    case eSetBits:               task->notifyValue |= value; break;
+    case eIncrement:             task->notifyValue++; break;
+    case eSetValueWithOverwrite: task->notifyValue = value; break;
+    case eNoAction:              break;
+  }
+  task->notifyPending = true;
+  hostCv.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+  xTaskNotify(task, 0, eIncrement);
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* woken) {
+  return xTaskNotify(task, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t wait) {
+  HostTask* self = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lk(hostLock);
+  if (!self->notifyPending) self->notifyValue &= ~clearOnEntry;
+  bool ok = hostWait(lk, [self]() { return self->notifyPending; }, wait);
+  if (value) *value = self->notifyValue;
+  if (ok) {
+    self->notifyValue &= ~clearOnExit;
+    self->notifyPending = false;
+  }
+  return ok ? pdTRUE : pdFALSE;
+}
+
+// ---------- PINS, REGISTERS, SPI ----------
+std::function<void(int, int)> hostOnDigitalWrite;
+std::function<int(int)> hostOnDigitalRead;
+std::function<void(int, int, uint8_t)> hostOnShiftOut;
+std::function<void(uint32_t, uint32_t)> hostOnRegWrite;
+std::function<uint32_t(uint32_t)> hostOnRegRead;
+std::function<void(const uint8_t*, size_t)> hostOnSpiTransaction;
+
+void pinMode(int pin, int mode) {}
+
+void digitalWrite(int pin, int value) {
+  if (hostOnDigitalWrite) hostOnDigitalWrite(pin, value);
+}
+
+int digitalRead(int pin) {
+  return hostOnDigitalRead ? hostOnDigitalRead(pin) : HIGH;
+}
+
+void shiftOut(int dataPin, int clockPin, int bitOrder, uint8_t value) {
+  if (hostOnShiftOut) hostOnShiftOut(dataPin, clockPin, value);
+}
+
+static std::vector<std::pair<int, void (*)()>> hostIsrs;
+
+void attachInterrupt(int pin, void (*isr)(), int mode) {
+  std::lock_guard<std::mutex> lk(hostLock);
+  hostIsrs.push_back(std::make_pair(pin, isr));
+}
+
+void hostFireInterrupt(int pin) {
+  hostSettle();
+  std::vector<void (*)()> isrs;
+  {
+    std::lock_guard<std::mutex> lk(hostLock);
+    for (auto& entry : hostIsrs) {
+      if (entry.first == pin) isrs.push_back(entry.second);
+    }
+  }
+  for (void (*isr)() : isrs) isr();
+  hostSettle();
+}
+
+void hostRegWrite(uint32_t reg, uint32_t value) {
+  if (hostOnRegWrite) hostOnRegWrite(reg, value);
+}
+
+uint32_t hostRegRead(uint32_t reg) {
+  return hostOnRegRead ? hostOnRegRead(reg) : 0xFFFFFFFF;
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* bus, int dma) { return ESP_OK; }
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* dev, spi_device_handle_t* handle) {
+  static int device;
+  *handle = (spi_device_handle_t)&device;
+  return ESP_OK;
+}
+
+static std::deque<spi_transaction_t*> hostSpiQueue;
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans, TickType_t wait) {
+  if (hostOnSpiTransaction) hostOnSpiTransaction((const uint8_t*)trans->tx_buffer, trans->length / 8);
+  hostSpiQueue.push_back(trans);
+  return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans, TickType_t wait) {
+  if (hostSpiQueue.empty()) return ESP_FAIL;
+  *trans = hostSpiQueue.front();
+  hostSpiQueue.pop_front();
+  return ESP_OK;
+}
+
+// ---------- SERIAL AND ESP ----------
+HardwareSerial Serial(0);
+EspClass ESP;
+
+void HardwareSerial::flush() {
+  unsigned long bits = unflushed * 10;
+  unflushed = 0;
+  unsigned long ms = (bits * 1000 + baud - 1) / baud;
+  if (ms) delay(ms);
+}
+
+std::string hostTakeSerialOutput() {
+  std::string out;
+  out.swap(Serial.output);
+  return out;
+}
+
+uint32_t EspClass::getCycleCount() {
+  // Host nanoseconds stand in for CPU cycles
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------- HEAP ----------
+// Every global new/delete is tracked so getFreeHeap() moves like the ESP32's
+static std::atomic<size_t> hostHeapUsed(0);
+static const size_t HOST_HEAP_SIZE = 320 * 1024;
+static const size_t HOST_HEAP_HEADER = 16;
+
+uint32_t EspClass::getFreeHeap() {
+  size_t used = hostHeapUsed.load();
+  return used < HOST_HEAP_SIZE ? (uint32_t)(HOST_HEAP_SIZE - used) : 0;
+}
+
+void EspClass::restart() {
+  abort();
+}
+
+void* operator new(size_t size) {
+  uint8_t* p = (uint8_t*)malloc(size + HOST_HEAP_HEADER);
+  if (!p) throw std::bad_alloc();
+  memcpy(p, &size, sizeof(size));
+  hostHeapUsed += size;
+  return p + HOST_HEAP_HEADER;
+}
+
+void operator delete(void* ptr) noexcept {
+  if (!ptr) return;
+  uint8_t* p = (uint8_t*)ptr - HOST_HEAP_HEADER;
+  size_t size;
+  memcpy(&size, p, sizeof(size));
+  hostHeapUsed -= size;
+  free(p);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
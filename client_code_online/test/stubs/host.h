@@ -0,0 +1,35 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <Arduino.h>
+#include <functional>
+#include <string>
+
+// ---------- TEST CONTROL ----------
+// Fake clock: moves only when a test advances it. hostAdvance() steps one
+// millisecond at a time and lets every task that became runnable finish
+// its work before the next step.
+void hostAdvance(unsigned long ms);
+void hostSetMicrosPerMilli(unsigned long us);  // micros() = millis * this + offset
+
+// Blocks until every task started with xTaskCreate*() is waiting on
+// something the fake clock has not yet satisfied
+void hostSettle();
+
+// Pin and register hooks; unset hooks read HIGH and ignore writes
+extern std::function<void(int pin, int value)> hostOnDigitalWrite;
+extern std::function<int(int pin)> hostOnDigitalRead;
+extern std::function<void(int dataPin, int clockPin, uint8_t value)> hostOnShiftOut;
+
+// Called as a task enters xEventGroupSetBits()/ClearBits(), before the bits
+// change: a test can stall it there, as preemption would on the chip
+extern std::function<void()> hostOnEventGroupWrite;
+
+// Runs the handlers attachInterrupt() registered for pin, as the GPIO ISR
+// would on an edge, and lets the tasks they woke run
+void hostFireInterrupt(int pin);
+
+// Everything the sketch printed to Serial since the last call
+std::string hostTakeSerialOutput();
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HOST_GPIO_REG_H
+#define HOST_GPIO_REG_H
+
+#include <Arduino.h>
+#include <functional>
+
+// Register addresses as on the ESP32; accesses go to the host.h hooks
+#define GPIO_OUT_W1TS_REG 0x3FF44008
+#define GPIO_OUT_W1TC_REG 0x3FF4400C
+#define GPIO_IN_REG       0x3FF4403C
+#define GPIO_IN1_REG      0x3FF44040
+
+void hostRegWrite(uint32_t reg, uint32_t value);
+uint32_t hostRegRead(uint32_t reg);
+extern std::function<void(uint32_t reg, uint32_t value)> hostOnRegWrite;
+extern std::function<uint32_t(uint32_t reg)> hostOnRegRead;
+
+#define REG_WRITE(reg, value) hostRegWrite((reg), (value))
+#define REG_READ(reg) hostRegRead(reg)
+
+#endif
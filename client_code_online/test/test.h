@@ -0,0 +1,69 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <unistd.h>
+#include <host.h>
+
+// ---------- HOST TESTS ----------
+// TEST(name) { ... } registers a case; CHECK / CHECK_EQ record a failure and
+// keep going. Each test binary ends with TEST_MAIN().
+typedef void (*TestFn)();
+
+struct TestCase {
+  const char* name;
+  TestFn fn;
+  TestCase* next;
+};
+
+extern TestCase* testCases;
+extern int testFailures;
+
+struct TestRegistrar {
+  TestRegistrar(TestCase* tc) {
+    // Keep declaration order
+    TestCase** at = &testCases;
+    while (*at) at = &(*at)->next;
+    *at = tc;
+  }
+};
+
+#define TEST(name)                                                    \
+  static void test_##name();                                          \
+  static TestCase testCase_##name = { #name, test_##name, NULL };     \
+  static TestRegistrar testReg_##name(&testCase_##name);              \
+  static void test_##name()
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      testFailures++;                                                 \
+    }                                                                 \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                \
+  do {                                                                \
+    long long va = (long long)(a), vb = (long long)(b);               \
+    if (va != vb) {                                                   \
+      printf("  %s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",      \
+             __FILE__, __LINE__, #a, #b, va, vb);                     \
+      testFailures++;                                                 \
+    }                                                                 \
+  } while (0)
+
+// Host tasks never return, so the process leaves with _exit()
+#define TEST_MAIN()                                                   \
+  TestCase* testCases = NULL;                                         \
+  int testFailures = 0;                                               \
+  int main() {                                                        \
+    for (TestCase* tc = testCases; tc; tc = tc->next) {               \
+      int before = testFailures;                                      \
+      tc->fn();                                                       \
+      printf("%s %s\n", testFailures == before ? "ok  " : "FAIL", tc->name); \
+    }                                                                 \
+    fflush(stdout);                                                   \
+    _exit(testFailures ? 1 : 0);                                      \
+  }
+
+#endif
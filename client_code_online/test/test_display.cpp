@@ -0,0 +1,237 @@
+#include "test.h"
+#include "display.h"
+#include "flow.h"
+#include <vector>
+
+// ---------- CHIP MODEL ----------
+// Two MAX7219s fed from whatever the selected backend puts on the wire: one
+// CS frame carries an (opcode, data) pair per device, farthest device first.
+struct ChipModel {
+  uint8_t digits[DISPLAY_DEVICES][8];
+  uint32_t frames = 0;
+  uint32_t bytes = 0;
+  uint32_t gpioWrites = 0;   // CPU pin toggles spent on the transfers
+  FILE* log = NULL;          // every frame, for comparing the backends
+
+  void apply(const uint8_t* wire, size_t len) {
+    if (log) {
+      for (size_t i = 0; i < len; i++) fprintf(log, "%02x", wire[i]);
+      fputc('\n', log);
+    }
+    int devices = len / 2;
+    for (int i = 0; i < devices; i++) {
+      int dev = devices - 1 - i;
+      uint8_t op = wire[i * 2];
+      if (op >= 1 && op <= 8) digits[dev][op - 1] = wire[i * 2 + 1];
+    }
+    frames++;
+    bytes += len;
+  }
+
+  void resetCounters() {
+    frames = 0;
+    bytes = 0;
+    gpioWrites = 0;
+  }
+};
+
+static ChipModel chip;
+
+// Both backends build from this file; the Makefile compares their frame
+// logs, so the bit-banged and SPI chains must put identical bytes on the wire
+#if DISPLAY_BACKEND == DISPLAY_BACKEND_SPI
+static const char* BACKEND_NAME = "spi";
+#else
+static const char* BACKEND_NAME = "bitbang";
+#endif
+
+static void captureWire() {
+#ifdef FRAME_LOG
+  chip.log = fopen(FRAME_LOG, "w");
+  setvbuf(chip.log, NULL, _IOLBF, 0);
+#endif
+#if DISPLAY_BACKEND == DISPLAY_BACKEND_SPI
+  hostOnSpiTransaction = [](const uint8_t* tx, size_t len) { chip.apply(tx, len); };
+#else
+  static std::vector<uint8_t> frame;
+  hostOnDigitalWrite = [](int pin, int value) {
+    chip.gpioWrites++;
+    if (pin != CS_PIN) return;
+    if (value == LOW) frame.clear();
+    else if (!frame.empty()) chip.apply(frame.data(), frame.size());
+  };
+  // shiftOut() toggles DIN and CLK for every bit
+  hostOnShiftOut = [](int dataPin, int clockPin, uint8_t value) {
+    chip.gpioWrites += 8 * 3;
+    frame.push_back(value);
+  };
+#endif
+}
+
+static void startDisplay() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  captureWire();
+  displayInit();
+  xTaskCreatePinnedToCore(displayRenderTask, "DisplayRender", 4096, NULL, 2, NULL, 1);
+  hostAdvance(100);
+}
+
+static const uint8_t SEG_DASH = 0x01;
+static const uint8_t SEG_0 = 0x7E;
+static const uint8_t SEG_E = 0x4F;
+static const uint8_t SEG_1 = 0x30;
+static const uint8_t SEG_2 = 0x6D;
+static const uint8_t SEG_3 = 0x79;
+
+// ---------- DIFFING ----------
+TEST(init_pushes_every_digit_once) {
+  startDisplay();
+  // STATUS_NORMAL with num1..3 = 0: customer digits 0,2,3 show '0'
+  for (int dev = 0; dev < DISPLAY_DEVICES; dev++) {
+    for (int d = 0; d < 8; d++) {
+      bool customer = dev == 0 && (d == 0 || d == 2 || d == 3);
+      CHECK_EQ(chip.digits[dev][d], customer ? SEG_0 : 0);
+    }
+  }
+  DisplayStats st = getDisplayStats();
+  CHECK(st.digits_written >= DISPLAY_DEVICES * 8);
+}
+
+TEST(chip_matches_error_pattern) {
+  startDisplay();
+  setStatus(STATUS_WIFI_ERROR);
+  hostAdvance(100);
+  for (int dev = 0; dev < DISPLAY_DEVICES; dev++) {
+    for (int d = 0; d < 8; d++) {
+      uint8_t want = SEG_DASH;
+      if (dev == 1 && (d == 0 || d == 5 || d == 1)) want = SEG_E;
+      if (dev == 1 && (d == 6 || d == 4 || d == 3)) want = SEG_1;
+      CHECK_EQ(chip.digits[dev][d], want);
+    }
+  }
+}
+
+// Leaving an error the firmware restores the status and the keypad counts
+// in the same breath; both intents fold into one frame
+TEST(chip_matches_normal_numbers) {
+  startDisplay();
+  setStatus(STATUS_NORMAL);
+  showNumbers(1, 2, 3);
+  hostAdvance(100);
+  CHECK_EQ(chip.digits[0][0], SEG_1);
+  CHECK_EQ(chip.digits[0][2], SEG_2);
+  CHECK_EQ(chip.digits[0][3], SEG_3);
+  for (int d = 0; d < 8; d++) CHECK_EQ(chip.digits[1][d], 0);
+}
+
+TEST(unchanged_redraw_costs_nothing) {
+  startDisplay();
+  setStatus(STATUS_NORMAL);
+  showNumbers(4, 5, 6);
+  hostAdvance(100);
+
+  chip.resetCounters();
+  for (int i = 0; i < 10; i++) {
+    setStatus(STATUS_NORMAL);
+    showNumbers(4, 5, 6);
+    hostAdvance(100);
+  }
+  CHECK_EQ(chip.bytes, 0);
+}
+
+TEST(changes_on_both_devices_share_frames) {
+  startDisplay();
+  setStatus(STATUS_NORMAL);
+  showNumbers(0, 0, 0);
+  hostAdvance(100);
+
+  // Three customer digits on device 0, three delivery digits on device 1
+  bread1_delivery_display = 1;
+  bread2_delivery_display = 2;
+  bread3_delivery_display = 3;
+  chip.resetCounters();
+  showNumbers(7, 8, 9);
+  flowDispatch(FLOW_EV_DELIVERY);
+  hostAdvance(100);
+  CHECK_EQ(chip.frames, 3);
+  CHECK_EQ(chip.bytes, 3 * DISPLAY_DEVICES * 2);
+  CHECK_EQ(chip.digits[1][0], SEG_1);
+
+  flowDispatch(FLOW_EV_DELIVERY_CANCEL);
+  hostAdvance(100);
+}
+
+// ---------- STATUS PATTERNS ----------
+// The calls the firmware makes for each live pattern, timed as it makes
+// them. LedControl clocked every one of them; the shadow only what changed.
+struct Scenario {
+  const char* name;
+  unsigned long durationMs;
+  unsigned long everyMs;
+  std::function<void()> setup;
+  std::function<void()> tick;
+  std::function<void()> teardown;
+};
+
+static void runScenario(const Scenario& sc) {
+  startDisplay();
+  if (sc.setup) sc.setup();
+  hostAdvance(100);
+  getDisplayStats();
+  chip.resetCounters();
+
+  for (unsigned long t = 0; t < sc.durationMs; t += sc.everyMs) {
+    if (sc.tick) sc.tick();
+    hostAdvance(sc.everyMs);
+  }
+
+  DisplayStats st = getDisplayStats();
+  uint32_t reduction = st.naive_bytes_per_sec ? 100 - (st.bytes_per_sec * 100 / st.naive_bytes_per_sec) : 0;
+  printf("  %-7s %-18s LedControl %5u B/s  shadow %4u B/s  (-%u%%)  %u txns, %u cpu gpio writes\n",
+         BACKEND_NAME, sc.name, st.naive_bytes_per_sec, st.bytes_per_sec, reduction,
+         st.transactions, chip.gpioWrites);
+  CHECK(st.bytes_per_sec < st.naive_bytes_per_sec);
+  CHECK_EQ(st.transactions, chip.frames);
+#if DISPLAY_BACKEND == DISPLAY_BACKEND_SPI
+  CHECK_EQ(chip.gpioWrites, 0);
+#else
+  // Per frame: CS low/high plus 24 pin writes per shifted byte
+  CHECK_EQ(chip.gpioWrites, chip.frames * 2 + chip.bytes * 24);
+#endif
+  CHECK_EQ(st.bytes_per_sec, (uint32_t)((uint64_t)chip.bytes * 1000 / sc.durationMs));
+  if (sc.teardown) sc.teardown();
+  hostAdvance(100);
+}
+
+TEST(status_pattern_reduction) {
+  runScenario({ "normal, 1 s status", 10000, 1000,
+                []() { setStatus(STATUS_NORMAL); },
+                []() { setStatus(STATUS_NORMAL); showNumbers(3, 1, 2); showCookDisplay(); },
+                NULL });
+
+  runScenario({ "confirm animation", 3000, 100,
+                []() {
+                  setStatus(STATUS_NORMAL);
+                  bread1_count = 2;
+                  bread2_count = 1;
+                  bread3_count = 0;
+                  flowDispatch(FLOW_EV_CONFIRM);
+                },
+                NULL,
+                []() { flowDispatch(FLOW_EV_REJECT); } });
+
+  runScenario({ "mqtt error retries", 30000, MQTT_RECONNECT_INTERVAL,
+                NULL,
+                []() { setStatus(STATUS_MQTT_CONNECTING); setStatus(STATUS_MQTT_ERROR); },
+                []() { setStatus(STATUS_NORMAL); } });
+
+  runScenario({ "wifi connecting", 30000, WIFI_RECONNECT_INTERVAL,
+                NULL,
+                []() { setStatus(STATUS_WIFI_CONNECTING); },
+                []() { setStatus(STATUS_NORMAL); } });
+}
+
+TEST_MAIN()
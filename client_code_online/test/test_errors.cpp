@@ -0,0 +1,84 @@
+#include "test.h"
+#include "errors.h"
+#include "mqtt_ring.h"
+#include <vector>
+
+// Payloads queued on the error topic since the last call, oldest first
+static std::vector<std::string> takeErrorRecords() {
+  std::vector<std::string> out;
+  MqttSlot* slot;
+  while ((slot = peekMqttSlot(0)) != NULL) {
+    if (slot->topic == MQTT_TOPIC_ERROR) out.push_back(slot->payload);
+    releaseMqttSlots(1);
+  }
+  return out;
+}
+
+// Closes every open window so the next case starts with an empty table
+static void resetErrors() {
+  hostAdvance(ERROR_DEDUP_WINDOW_MS);
+  errorsTick();
+  takeErrorRecords();
+}
+
+TEST(first_occurrence_published_repeats_summarised) {
+  initMqttQueue();
+  resetErrors();
+
+  reportError(ERR_NET_HTTP_RETRIES, -11);
+  reportError(ERR_NET_HTTP_RETRIES, -11);
+  reportError(ERR_NET_HTTP_RETRIES, -11);
+  std::vector<std::string> recs = takeErrorRecords();
+  CHECK_EQ(recs.size(), 1);
+  CHECK(recs.size() == 1 && recs[0].compare(0, 10, "201,-11,1,") == 0);
+
+  hostAdvance(ERROR_DEDUP_WINDOW_MS);
+  errorsTick();
+  recs = takeErrorRecords();
+  CHECK_EQ(recs.size(), 1);
+  CHECK(recs.size() == 1 && recs[0].compare(0, 10, "201,-11,3,") == 0);
+}
+
+TEST(single_occurrence_has_no_summary) {
+  initMqttQueue();
+  resetErrors();
+
+  reportError(ERR_SYS_DEADLOCK);
+  takeErrorRecords();
+  hostAdvance(ERROR_DEDUP_WINDOW_MS);
+  errorsTick();
+  CHECK_EQ(takeErrorRecords().size(), 0);
+}
+
+TEST(eviction_publishes_suppressed_count) {
+  initMqttQueue();
+  resetErrors();
+
+  // The oldest record collects repeats, then the table fills up
+  reportError(ERR_API_QUEUE_FULL, 1);
+  reportError(ERR_API_QUEUE_FULL, 1);
+  reportError(ERR_API_QUEUE_FULL, 1);
+  for (int i = 1; i < ERROR_DEDUP_SLOTS; i++) {
+    hostAdvance(1);
+    reportError(ERR_TASK_SERVE_TICKET, i);
+  }
+  takeErrorRecords();
+
+  // One more distinct error evicts the oldest, which reports its 3 first
+  hostAdvance(1);
+  reportError(ERR_TASK_WAIT_LIST, 99);
+  std::vector<std::string> recs = takeErrorRecords();
+  CHECK_EQ(recs.size(), 2);
+  if (recs.size() == 2) {
+    CHECK(recs[0].compare(0, 8, "170,1,3,") == 0);
+    CHECK(recs[1].compare(0, 9, "304,99,1,") == 0);
+  }
+
+  // Evicting a record that was never repeated stays silent
+  hostAdvance(1);
+  reportError(ERR_TASK_WAIT_LIST, 100);
+  recs = takeErrorRecords();
+  CHECK_EQ(recs.size(), 1);
+}
+
+TEST_MAIN()
@@ -0,0 +1,267 @@
+#include "test.h"
+#include "flow.h"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// ---------- REFERENCE MODEL ----------
+// The order/delivery rules written out longhand, independent of flowTable
+struct FlowModel {
+  bool confirming = false;
+  bool uploading = false;
+  bool delivery = false;
+  int display = DISPLAY_MODE_NONE;
+  int counts[3] = {};     // keypad counts
+  int baker[3] = {};
+  int shown[3] = {};      // delivery digits
+
+  static int total(const int* v) { return v[0] + v[1] + v[2]; }
+
+  int displayAfterBakerCleared() const {
+    return delivery && total(shown) > 0 ? DISPLAY_MODE_DELIVERY : DISPLAY_MODE_NONE;
+  }
+
+  void clearDelivery() {
+    delivery = false;
+    for (int i = 0; i < 3; i++) shown[i] = 0;
+    display = total(baker) > 0 ? DISPLAY_MODE_BAKER : DISPLAY_MODE_NONE;
+  }
+
+  bool apply(FlowEvent ev) {
+    switch (ev) {
+      case FLOW_EV_CONFIRM:
+        if (confirming) return false;
+        confirming = true;
+        for (int i = 0; i < 3; i++) baker[i] = counts[i];
+        if (display == DISPLAY_MODE_NONE) display = DISPLAY_MODE_BAKER;
+        return true;
+      case FLOW_EV_ACCEPT:
+        if (!confirming) return false;
+        confirming = false;
+        uploading = true;
+        return true;
+      case FLOW_EV_REJECT:
+        if (!confirming) return false;
+        confirming = false;
+        for (int i = 0; i < 3; i++) baker[i] = 0;
+        display = displayAfterBakerCleared();
+        return true;
+      case FLOW_EV_ORDERS_DRAINED:
+        if (!uploading) return false;
+        uploading = false;
+        // The next order is already being confirmed: its counts own the baker digits
+        if (!confirming) {
+          for (int i = 0; i < 3; i++) baker[i] = 0;
+          display = displayAfterBakerCleared();
+        }
+        return true;
+      case FLOW_EV_DELIVERY:
+        if (delivery) return false;
+        delivery = true;
+        if (display == DISPLAY_MODE_NONE) display = DISPLAY_MODE_DELIVERY;
+        return true;
+      case FLOW_EV_DELIVERY_DONE:
+        if (!delivery || display != DISPLAY_MODE_DELIVERY) return false;
+        clearDelivery();
+        return true;
+      case FLOW_EV_DELIVERY_CANCEL:
+        if (!delivery) return false;
+        clearDelivery();
+        return true;
+    }
+    return false;
+  }
+
+  uint8_t state() const {
+    return (confirming ? FLOW_CONFIRMING : 0) | (uploading ? FLOW_UPLOADING : 0) |
+           (delivery ? FLOW_DELIVERY : 0) | (display << 4);
+  }
+};
+
+static const int EVENT_COUNT = FLOW_EV_DELIVERY_CANCEL + 1;
+static const char* const eventNames[EVENT_COUNT] = {
+  "CONFIRM", "ACCEPT", "REJECT", "ORDERS_DRAINED", "DELIVERY", "DELIVERY_DONE", "DELIVERY_CANCEL"
+};
+
+static void setGlobals(const FlowModel& m) {
+  bread1_count = m.counts[0];
+  bread2_count = m.counts[1];
+  bread3_count = m.counts[2];
+  bread1_delivery_display = m.shown[0];
+  bread2_delivery_display = m.shown[1];
+  bread3_delivery_display = m.shown[2];
+}
+
+static bool matchesModel(const FlowModel& m) {
+  return flowGetState() == m.state() &&
+         bread1_count_baker_display == m.baker[0] &&
+         bread2_count_baker_display == m.baker[1] &&
+         bread3_count_baker_display == m.baker[2] &&
+         bread1_delivery_display == m.shown[0] &&
+         bread2_delivery_display == m.shown[1] &&
+         bread3_delivery_display == m.shown[2];
+}
+
+static void startFlow() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+  initFlow();
+}
+
+// ---------- RANDOMIZED REPLAY ----------
+// Random events, with the inputs the real callers set first: keypad counts
+// before CONFIRM (never an empty order), delivery digits before DELIVERY
+TEST(random_events_match_reference_model) {
+  startFlow();
+  FlowModel model;
+  std::mt19937 rng(7);
+  uint32_t rejectedBefore = getFlowRejectedCount();
+  int accepted[EVENT_COUNT] = {};
+  int rejected = 0;
+  int mismatches = 0;
+  std::vector<std::string> trace;
+
+  for (int step = 0; step < 200000; step++) {
+    FlowEvent ev = (FlowEvent)(rng() % EVENT_COUNT);
+    if (ev == FLOW_EV_CONFIRM && !model.confirming) {
+      do {
+        for (int i = 0; i < 3; i++) model.counts[i] = rng() % 4;
+      } while (FlowModel::total(model.counts) == 0);
+    }
+    if (ev == FLOW_EV_DELIVERY && !model.delivery) {
+      // The server may serve a ticket with nothing left to hand over
+      for (int i = 0; i < 3; i++) model.shown[i] = rng() % 3;
+    }
+    setGlobals(model);
+
+    uint8_t from = model.state();
+    bool want = model.apply(ev);
+    bool got = flowDispatch(ev);
+    if (want) accepted[ev]++;
+    else rejected++;
+
+    char line[64];
+    snprintf(line, sizeof(line), "%s 0x%02x -> 0x%02x%s", eventNames[ev], from, model.state(),
+             want ? "" : " (rejected)");
+    trace.push_back(line);
+
+    if (got != want || !matchesModel(model)) {
+      if (mismatches++ < 5) {
+        printf("  step %d: %s from 0x%02x: flow %s -> 0x%02x, model %s -> 0x%02x\n",
+               step, eventNames[ev], from, got ? "ok" : "rejected", flowGetState(),
+               want ? "ok" : "rejected", model.state());
+      }
+      break;
+    }
+    CHECK_EQ(flowWaitNoDelivery(0), !model.delivery);
+  }
+
+  CHECK_EQ(mismatches, 0);
+  if (mismatches) return;
+  CHECK_EQ(getFlowRejectedCount() - rejectedBefore, rejected);
+  // Every transition must have been reachable
+  for (int ev = 0; ev < EVENT_COUNT; ev++) {
+    if (accepted[ev] == 0) printf("  %s never accepted\n", eventNames[ev]);
+    CHECK(accepted[ev] > 0);
+  }
+
+  // The log holds the last FLOW_LOG_SIZE transitions, oldest first
+  hostTakeSerialOutput();
+  flowPrintLog();
+  std::istringstream out(hostTakeSerialOutput());
+  std::string line;
+  size_t i = trace.size() - FLOW_LOG_SIZE;
+  int lines = 0;
+  while (std::getline(out, line)) {
+    // "flow <ms> <rest>"
+    std::string rest = line.substr(line.find(' ', 5) + 1);
+    CHECK(i < trace.size() && rest == trace[i]);
+    i++;
+    lines++;
+  }
+  CHECK_EQ(lines, FLOW_LOG_SIZE);
+}
+
+// Keypad, order worker and ticket flow dispatch from different tasks; the
+// mux must keep every transition whole
+TEST(concurrent_dispatch_keeps_transitions_whole) {
+  startFlow();
+  const int threads = 4;
+  const int perThread = 50000;
+  uint32_t rejectedBefore = getFlowRejectedCount();
+  std::atomic<int> accepted(0);
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([t, &accepted]() {
+      std::mt19937 rng(100 + t);
+      for (int i = 0; i < perThread; i++) {
+        if (flowDispatch((FlowEvent)(rng() % EVENT_COUNT))) accepted++;
+      }
+    });
+  }
+  for (std::thread& w : workers) w.join();
+
+  CHECK_EQ(accepted.load() + (getFlowRejectedCount() - rejectedBefore), threads * perThread);
+
+  // Consecutive log entries chain, and the newest one is the current state
+  hostTakeSerialOutput();
+  flowPrintLog();
+  std::istringstream out(hostTakeSerialOutput());
+  std::string line;
+  int prevTo = -1, to = -1;
+  while (std::getline(out, line)) {
+    unsigned from;
+    char name[32];
+    unsigned long ms;
+    unsigned next;
+    CHECK(sscanf(line.c_str(), "flow %lu %31s 0x%x -> 0x%x", &ms, name, &from, &next) == 4);
+    if (prevTo >= 0) CHECK_EQ(from, prevTo);
+    prevTo = to = next;
+  }
+  CHECK_EQ(to, flowGetState());
+  // Display mode DELIVERY only ever shows a pending delivery
+  uint8_t st = flowGetState();
+  if ((st >> 4) == DISPLAY_MODE_DELIVERY) CHECK(st & FLOW_DELIVERY);
+  CHECK_EQ(flowWaitNoDelivery(0), !(st & FLOW_DELIVERY));
+}
+
+// The scanner's DELIVERY racing the order worker's ORDERS_DRAINED: once both
+// return, the no-delivery bit the scanner waits on must match the state, or
+// the next scan overwrites the delivery still on the display. Each task is
+// stalled at random before it touches the event group, as preemption would.
+TEST(no_delivery_bit_follows_concurrent_dispatch) {
+  startFlow();
+  static std::atomic<uint32_t> seed(1);
+  static auto stall = []() {
+    static thread_local std::mt19937 rng(seed++);
+    std::this_thread::sleep_for(std::chrono::microseconds(rng() % 100));
+  };
+  hostOnEventGroupWrite = stall;
+
+  int mismatches = 0;
+  for (int round = 0; round < 2000 && mismatches == 0; round++) {
+    flowDispatch(FLOW_EV_DELIVERY_CANCEL);
+    bread1_count = 1;
+    flowDispatch(FLOW_EV_CONFIRM);
+    flowDispatch(FLOW_EV_ACCEPT);
+
+    std::thread worker([]() { stall(); flowDispatch(FLOW_EV_ORDERS_DRAINED); });
+    std::thread scanner([]() { stall(); flowDispatch(FLOW_EV_DELIVERY); });
+    scanner.join();
+    worker.join();
+    if (flowWaitNoDelivery(0) != !flowDeliveryPending()) {
+      printf("  round %d: state 0x%02x, no-delivery bit %d\n", round, flowGetState(), flowWaitNoDelivery(0));
+      mismatches++;
+    }
+  }
+  hostOnEventGroupWrite = NULL;
+  CHECK_EQ(mismatches, 0);
+  flowDispatch(FLOW_EV_DELIVERY_CANCEL);
+}
+
+TEST_MAIN()
@@ -0,0 +1,272 @@
+#include "test.h"
+#include "http_stream.h"
+#include <vector>
+
+// A socket holding whatever the server sent, possibly followed by the next
+// keep-alive response
+class FakeSocket : public Stream {
+ public:
+  explicit FakeSocket(const std::string& bytes) : bytes(bytes) {}
+  int available() override { return (int)(bytes.size() - pos); }
+  int read() override { return pos < bytes.size() ? (uint8_t)bytes[pos++] : -1; }
+  int peek() override { return pos < bytes.size() ? (uint8_t)bytes[pos] : -1; }
+  size_t write(uint8_t) override { return 0; }
+  std::string rest() const { return bytes.substr(pos); }
+
+  std::string bytes;
+  size_t pos = 0;
+};
+
+static std::string readAll(HttpBodyStream& body) {
+  std::string out;
+  int c;
+  while ((c = body.read()) >= 0) out.push_back((char)c);
+  return out;
+}
+
+static std::string chunked(const std::string& body, size_t chunkSize) {
+  std::string out;
+  char line[16];
+  for (size_t i = 0; i < body.size(); i += chunkSize) {
+    std::string part = body.substr(i, chunkSize);
+    snprintf(line, sizeof(line), "%zx\r\n", part.size());
+    out += line + part + "\r\n";
+  }
+  return out + "0\r\n\r\n";
+}
+
+static const char* NEXT = "HTTP/1.1 200 OK\r\n";
+
+TEST(content_length_body_stops_at_length) {
+  FakeSocket sock(std::string("{\"a\":1}") + NEXT);
+  HttpBodyStream body(sock, 7, false);
+  CHECK(readAll(body) == "{\"a\":1}");
+  CHECK_EQ(body.read(), -1);
+  CHECK(sock.rest() == NEXT);
+}
+
+TEST(chunked_body_is_decoded_across_chunks) {
+  std::string json = "{\"customer_ticket_id\":42,\"show_on_display\":true}";
+  FakeSocket sock(chunked(json, 5) + NEXT);
+  HttpBodyStream body(sock, -1, true);
+  CHECK(readAll(body) == json);
+  CHECK(sock.rest() == NEXT);
+}
+
+TEST(chunk_extensions_and_uppercase_sizes) {
+  FakeSocket sock(std::string("A;name=v\r\n0123456789\r\n3\r\nabc\r\n0\r\n\r\n") + NEXT);
+  HttpBodyStream body(sock, -1, true);
+  CHECK(readAll(body) == "0123456789abc");
+  CHECK(sock.rest() == NEXT);
+}
+
+TEST(peek_crosses_chunk_boundaries) {
+  FakeSocket sock(chunked("ab", 1));
+  HttpBodyStream body(sock, -1, true);
+  CHECK_EQ(body.read(), 'a');
+  CHECK_EQ(body.peek(), 'b');
+  CHECK_EQ(body.read(), 'b');
+  CHECK_EQ(body.peek(), -1);
+}
+
+TEST(drain_leaves_socket_at_next_response) {
+  std::string json = "{\"current_ticket_id\":7,\"breads\":{\"1\":2,\"2\":0},\"extra\":\"ignored\"}";
+
+  FakeSocket plain(json + NEXT);
+  HttpBodyStream a(plain, json.size(), false);
+  for (int i = 0; i < 10; i++) a.read();  // parser stopped early
+  a.drain();
+  CHECK(plain.rest() == NEXT);
+
+  FakeSocket chunkedSock(chunked(json, 16) + NEXT);
+  HttpBodyStream b(chunkedSock, -1, true);
+  for (int i = 0; i < 20; i++) b.read();
+  b.drain();
+  CHECK(chunkedSock.rest() == NEXT);
+}
+
+TEST(unknown_length_reads_until_close) {
+  FakeSocket sock("{\"ok\":true}");
+  HttpBodyStream body(sock, -1, false);
+  CHECK(readAll(body) == "{\"ok\":true}");
+}
+
+TEST(empty_body) {
+  FakeSocket sock(NEXT);
+  HttpBodyStream body(sock, 0, false);
+  CHECK_EQ(body.read(), -1);
+  CHECK_EQ(body.peek(), -1);
+  CHECK(sock.rest() == NEXT);
+}
+
+TEST(truncated_chunk_ends_body) {
+  FakeSocket sock("10\r\nshort");
+  HttpBodyStream body(sock, -1, true);
+  CHECK(readAll(body) == "short");
+  CHECK_EQ(body.read(), -1);
+}
+
+// ---------- MEMORY PER CALL ----------
+// ArduinoJson is not part of the host build, so document sizes follow its v6
+// sizing rules for a 32-bit target instead of running the library: one
+// 16-byte slot per object member or array element, and every key and string
+// value read from a stream copied once with its NUL (identical strings
+// deduplicated). A filter keeps the listed top-level members whole and
+// allocates nothing for the rest.
+struct DocSizer {
+  const char* p;
+  std::vector<std::string> strings;
+
+  size_t copyString(const std::string& s) {
+    for (const std::string& seen : strings) if (seen == s) return 0;
+    strings.push_back(s);
+    return s.size() + 1;
+  }
+
+  std::string readString() {
+    std::string out;
+    p++;  // opening quote
+    while (*p != '"') {
+      if (*p == '\\') p++;
+      out.push_back(*p++);
+    }
+    p++;
+    return out;
+  }
+
+  void skipSpace() { while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') p++; }
+
+  // Pool bytes for the value at p; nothing is allocated when !keep
+  size_t value(bool keep, const std::vector<std::string>* filter = NULL) {
+    skipSpace();
+    size_t pool = 0;
+    if (*p == '{' || *p == '[') {
+      bool object = *p == '{';
+      p++;
+      skipSpace();
+      while (*p != '}' && *p != ']') {
+        bool keepMember = keep;
+        if (object) {
+          std::string key = readString();
+          if (filter) {
+            keepMember = false;
+            for (const std::string& k : *filter) if (k == key) keepMember = true;
+          }
+          if (keepMember) pool += copyString(key);
+          skipSpace();
+          p++;  // ':'
+        }
+        if (keepMember) pool += 16;
+        pool += value(keepMember);
+        skipSpace();
+        if (*p == ',') p++;
+        skipSpace();
+      }
+      p++;
+    } else if (*p == '"') {
+      std::string s = readString();
+      if (keep) pool += copyString(s);
+    } else {
+      while (*p && *p != ',' && *p != '}' && *p != ']') p++;
+    }
+    return pool;
+  }
+
+  static size_t of(const std::string& json, const std::vector<std::string>* filter) {
+    DocSizer d;
+    d.p = json.c_str();
+    return d.value(true, filter);
+  }
+};
+
+struct EndpointCase {
+  const char* name;
+  size_t oldCapacity;                // StaticJsonDocument before streaming
+  size_t newCapacity;                // 0 when the body is only drained
+  std::vector<std::string> filter;   // empty: the whole body is kept
+  std::string body;                  // a representative server response
+};
+
+// Heap held while the body is in memory: the old path grew a String from the
+// socket (getString) before deserializeJson; the new one parses from it
+static uint32_t stringHeapFor(const std::string& wire) {
+  FakeSocket sock(wire);
+  HttpBodyStream body(sock, -1, true);
+  uint32_t before = ESP.getFreeHeap();
+  uint32_t low = before;
+  String copy;
+  int c;
+  while ((c = body.read()) >= 0) {
+    copy += (char)c;
+    if (ESP.getFreeHeap() < low) low = ESP.getFreeHeap();
+  }
+  return before - low;
+}
+
+static uint32_t streamedHeapFor(const std::string& wire) {
+  FakeSocket sock(wire);
+  HttpBodyStream body(sock, -1, true);
+  uint32_t before = ESP.getFreeHeap();
+  uint32_t low = before;
+  while (body.read() >= 0) {
+    if (ESP.getFreeHeap() < low) low = ESP.getFreeHeap();
+  }
+  return before - low;
+}
+
+TEST(memory_per_call_by_endpoint) {
+  const EndpointCase cases[] = {
+    { "hardware_init", 768, 768, {},
+      "{\"1\":900,\"2\":1200,\"3\":600,\"4\":750,\"5\":1500,\"6\":480}" },
+    { "new_ticket", 256, 128, { "customer_ticket_id", "show_on_display" },
+      "{\"customer_ticket_id\":1234,\"show_on_display\":true,\"bakery_id\":3,"
+      "\"bread_requirements\":{\"1\":2,\"2\":1,\"3\":0},\"created_at\":\"2026-10-17T08:31:12.512Z\","
+      "\"queue_position\":7,\"estimated_wait\":540}" },
+    { "new_bread", 512, 256, { "bread_index", "customer_breads" },
+      "{\"bread_index\":2,\"customer_breads\":{\"1\":2,\"2\":1,\"3\":0},\"customer_ticket_id\":1230,"
+      "\"bakery_id\":3,\"message\":\"bread added to the current customer\"}" },
+    { "current_cook_customer", 512, 256, { "has_customer", "customer_breads" },
+      "{\"has_customer\":true,\"customer_breads\":{\"1\":2,\"2\":1,\"3\":0},\"customer_ticket_id\":1229,"
+      "\"bakery_id\":3,\"started_at\":\"2026-10-17T08:29:40.101Z\"}" },
+    { "serve_ticket", 768, 384, { "current_ticket_id", "skipped_customer", "user_detail" },
+      "{\"current_ticket_id\":1231,\"skipped_customer\":false,\"user_detail\":{\"1\":2,\"2\":0,\"3\":1},"
+      "\"bakery_id\":3,\"served_at\":\"2026-10-17T08:35:02.877Z\",\"wait_list\":[1225,1227,1228]}" },
+    { "current_ticket", 768, 384,
+      { "ready", "wait_until", "has_customer_in_queue", "current_ticket_id", "current_user_detail" },
+      "{\"ready\":true,\"wait_until\":0,\"has_customer_in_queue\":true,\"current_ticket_id\":1231,"
+      "\"current_user_detail\":{\"1\":2,\"2\":0,\"3\":1},\"bakery_id\":3,"
+      "\"queue\":[1232,1233,1234,1235],\"server_time\":\"2026-10-17T08:35:03.004Z\"}" },
+    { "wait_list", 0, 0, {},
+      "{\"status\":\"ok\",\"customer_ticket_id\":1231,\"wait_list\":[1225,1227,1228,1231]}" },
+  };
+
+  printf("  %-22s %6s | %-32s | %s\n", "endpoint", "body", "String + document (old)", "filtered document (now)");
+  for (const EndpointCase& ec : cases) {
+    std::string wire = chunked(ec.body, 256);
+    uint32_t oldHeap = stringHeapFor(wire);
+    uint32_t newHeap = streamedHeapFor(wire);
+    size_t oldDoc = ec.oldCapacity ? DocSizer::of(ec.body, NULL) : 0;
+    size_t newDoc = ec.newCapacity ? DocSizer::of(ec.body, ec.filter.empty() ? NULL : &ec.filter) : 0;
+
+    printf("  %-22s %4zu B | %4u B heap + %3zu/%3zu B%-9s | %u B heap + %3zu/%3zu B\n",
+           ec.name, ec.body.size(), oldHeap, oldDoc, ec.oldCapacity,
+           oldDoc > ec.oldCapacity ? " NoMemory" : "", newHeap, newDoc, ec.newCapacity);
+    CHECK(oldHeap >= ec.body.size());
+    CHECK_EQ(newHeap, 0);
+    // The unfiltered document outgrows the old capacity as soon as the server
+    // adds fields; the filtered one must keep fitting
+    CHECK(newDoc <= ec.newCapacity);
+    if (!ec.filter.empty()) CHECK(newDoc < oldDoc);
+  }
+}
+
+// The sizing rules themselves, on bodies small enough to count by hand
+TEST(doc_sizer_counts_slots_and_strings) {
+  CHECK_EQ(DocSizer::of("{\"1\":900,\"2\":1200}", NULL), 2 * 16 + 2 + 2);
+  CHECK_EQ(DocSizer::of("{\"a\":\"x\",\"b\":\"x\"}", NULL), 2 * 16 + 2 + 2 + 2);
+  CHECK_EQ(DocSizer::of("{\"k\":[1,2],\"d\":{\"1\":2}}", NULL), 16 + 2 + 2 * 16 + 16 + 2 + 16 + 2);
+  std::vector<std::string> filter = { "k" };
+  CHECK_EQ(DocSizer::of("{\"k\":[1,2],\"d\":{\"1\":2}}", &filter), 16 + 2 + 2 * 16);
+}
+
+TEST_MAIN()
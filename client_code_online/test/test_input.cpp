@@ -0,0 +1,397 @@
+#include "test.h"
+#include "input.h"
+#include <esp_timer.h>
+#include <soc/gpio_reg.h>
+#include <chrono>
+#include <vector>
+
+// ---------- KEYPAD MODEL ----------
+// A 3x3 matrix (rows driven, columns pulled up) plus the two buttons. A key
+// can chatter for a while after it changes; the model then reports it
+// flipping every couple of milliseconds.
+static const int rowPins[3] = { ROW1_PIN, ROW2_PIN, ROW3_PIN };
+static const int colPins[3] = { COL1_PIN, COL2_PIN, COL3_PIN };
+
+struct Keypad {
+  bool down[INPUT_KEY_COUNT] = {};
+  unsigned long bounceUntil[INPUT_KEY_COUNT] = {};
+  uint64_t outLevels = ~0ULL;     // what the row pins are driven to
+  uint32_t regWrites = 0, regReads = 0;
+  uint32_t pinWrites = 0, pinReads = 0;
+
+  bool contact(int k) const {
+    if (millis() < bounceUntil[k]) return (millis() / 2) & 1;
+    return down[k];
+  }
+
+  int pinLevel(int pin) const {
+    for (int col = 0; col < 3; col++) {
+      if (pin != colPins[col]) continue;
+      for (int row = 0; row < 3; row++) {
+        bool rowLow = !((outLevels >> rowPins[row]) & 1);
+        if (rowLow && contact(INPUT_KEY_MATRIX(row, col))) return LOW;
+      }
+      return HIGH;
+    }
+    if (pin == CONFIRM_BUTTON_PIN) return contact(INPUT_KEY_CONFIRM) ? LOW : HIGH;
+    if (pin == NEW_BREAD_BUTTON_PIN) return contact(INPUT_KEY_NEW_BREAD) ? LOW : HIGH;
+    return (outLevels >> pin) & 1;
+  }
+
+  uint64_t levels() const {
+    uint64_t v = outLevels | (1ULL << CONFIRM_BUTTON_PIN) | (1ULL << NEW_BREAD_BUTTON_PIN);
+    for (int col = 0; col < 3; col++) {
+      if (!pinLevel(colPins[col])) v &= ~(1ULL << colPins[col]);
+    }
+    if (contact(INPUT_KEY_CONFIRM)) v &= ~(1ULL << CONFIRM_BUTTON_PIN);
+    if (contact(INPUT_KEY_NEW_BREAD)) v &= ~(1ULL << NEW_BREAD_BUTTON_PIN);
+    return v;
+  }
+
+  // The pin whose edge a key raises while the rows idle LOW
+  static int edgePin(int k) {
+    if (k == INPUT_KEY_CONFIRM) return CONFIRM_BUTTON_PIN;
+    if (k == INPUT_KEY_NEW_BREAD) return NEW_BREAD_BUTTON_PIN;
+    return colPins[k % 3];
+  }
+};
+
+static Keypad pad;
+
+static void installHooks() {
+  hostOnRegWrite = [](uint32_t reg, uint32_t value) {
+    pad.regWrites++;
+    if (reg == GPIO_OUT_W1TS_REG) pad.outLevels |= value;
+    if (reg == GPIO_OUT_W1TC_REG) pad.outLevels &= ~(uint64_t)value;
+  };
+  hostOnRegRead = [](uint32_t reg) -> uint32_t {
+    pad.regReads++;
+    uint64_t v = pad.levels();
+    return reg == GPIO_IN1_REG ? (uint32_t)(v >> 32) : (uint32_t)v;
+  };
+  hostOnDigitalWrite = [](int pin, int value) {
+    pad.pinWrites++;
+    if (value) pad.outLevels |= 1ULL << pin;
+    else pad.outLevels &= ~(1ULL << pin);
+  };
+  hostOnDigitalRead = [](int pin) {
+    pad.pinReads++;
+    return pad.pinLevel(pin);
+  };
+}
+
+// Advance the clock a millisecond at a time, raising the GPIO interrupt
+// whenever a key's contact changes (every bounce included)
+static void run(unsigned long ms) {
+  for (unsigned long i = 0; i < ms; i++) {
+    bool before[INPUT_KEY_COUNT];
+    for (int k = 0; k < INPUT_KEY_COUNT; k++) before[k] = pad.contact(k);
+    hostAdvance(1);
+    for (int k = 0; k < INPUT_KEY_COUNT; k++) {
+      if (pad.contact(k) != before[k]) hostFireInterrupt(Keypad::edgePin(k));
+    }
+  }
+}
+
+static void setKey(int k, bool down, unsigned long bounceMs = 0) {
+  pad.down[k] = down;
+  pad.bounceUntil[k] = millis() + bounceMs;
+  hostFireInterrupt(Keypad::edgePin(k));
+}
+
+static std::vector<InputEvent> takeEvents() {
+  std::vector<InputEvent> out;
+  InputEvent ev;
+  while (inputNextEvent(ev, 0)) out.push_back(ev);
+  return out;
+}
+
+static int countEvents(const std::vector<InputEvent>& evs, InputEventType type, int key = -1) {
+  int n = 0;
+  for (const InputEvent& ev : evs) {
+    if (ev.type == type && (key < 0 || ev.key == key)) n++;
+  }
+  return n;
+}
+
+static void startInput() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  installHooks();
+  initInput();
+  xTaskCreatePinnedToCore(inputTask, "Input", 4096, NULL, 3, NULL, 1);
+  run(100);
+  takeEvents();
+  getInputStats();
+}
+
+static const int KEY_PLUS = INPUT_KEY_MATRIX(0, 0);
+static const int KEY_ACCEPT = INPUT_KEY_MATRIX(1, 2);
+
+// ---------- DEBOUNCE ----------
+TEST(clean_press_and_release) {
+  startInput();
+  unsigned long pressedAt = millis();
+  setKey(KEY_ACCEPT, true);
+  run(100);
+  std::vector<InputEvent> evs = takeEvents();
+  CHECK_EQ(evs.size(), 1);
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_PRESS, KEY_ACCEPT), 1);
+  // Four agreeing scans, the first one right on the edge
+  uint32_t latencyMs = (evs[0].at_us - pressedAt * 1000) / 1000;
+  CHECK(latencyMs >= 3 * INPUT_SCAN_MS && latencyMs <= 4 * INPUT_SCAN_MS);
+  CHECK_EQ(evs[0].keys, 1u << KEY_ACCEPT);
+
+  setKey(KEY_ACCEPT, false);
+  run(100);
+  evs = takeEvents();
+  CHECK_EQ(evs.size(), 1);
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_RELEASE, KEY_ACCEPT), 1);
+  CHECK_EQ(evs[0].keys, 0);
+}
+
+TEST(bouncing_contacts_give_one_event_each_way) {
+  startInput();
+  setKey(INPUT_KEY_CONFIRM, true, 15);
+  run(150);
+  setKey(INPUT_KEY_CONFIRM, false, 15);
+  run(150);
+  std::vector<InputEvent> evs = takeEvents();
+  CHECK_EQ(evs.size(), 2);
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_PRESS, INPUT_KEY_CONFIRM), 1);
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_RELEASE, INPUT_KEY_CONFIRM), 1);
+}
+
+TEST(short_glitch_is_ignored) {
+  startInput();
+  for (int i = 0; i < 5; i++) {
+    setKey(INPUT_KEY_NEW_BREAD, true);
+    run(2 * INPUT_SCAN_MS);
+    setKey(INPUT_KEY_NEW_BREAD, false);
+    run(2 * INPUT_SCAN_MS);
+  }
+  run(100);
+  CHECK_EQ(takeEvents().size(), 0);
+}
+
+TEST(idle_keypad_never_scans) {
+  startInput();
+  run(100);
+  getInputStats();
+  run(5000);
+  CHECK_EQ(getInputStats().wakeups, 0);
+}
+
+// ---------- CHORDS AND REPEAT ----------
+TEST(second_key_makes_a_chord) {
+  startInput();
+  setKey(KEY_PLUS, true);
+  run(100);
+  setKey(INPUT_KEY_CONFIRM, true);
+  run(100);
+  std::vector<InputEvent> evs = takeEvents();
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_PRESS, KEY_PLUS), 1);
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_PRESS, INPUT_KEY_CONFIRM), 1);
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_CHORD, INPUT_KEY_CONFIRM), 1);
+  for (const InputEvent& ev : evs) {
+    if (ev.type == INPUT_EVENT_CHORD) CHECK_EQ(ev.keys, (1u << KEY_PLUS) | (1u << INPUT_KEY_CONFIRM));
+  }
+
+  // No repeat while another key is down
+  run(1000);
+  CHECK_EQ(countEvents(takeEvents(), INPUT_EVENT_REPEAT), 0);
+
+  setKey(KEY_PLUS, false);
+  setKey(INPUT_KEY_CONFIRM, false);
+  run(100);
+  CHECK_EQ(countEvents(takeEvents(), INPUT_EVENT_RELEASE), 2);
+}
+
+TEST(held_plus_key_repeats) {
+  startInput();
+  setKey(KEY_PLUS, true);
+  run(1200);
+  std::vector<InputEvent> evs = takeEvents();
+  setKey(KEY_PLUS, false);
+  run(100);
+  takeEvents();
+
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_PRESS, KEY_PLUS), 1);
+  std::vector<uint32_t> at;
+  for (const InputEvent& ev : evs) {
+    if (ev.type == INPUT_EVENT_REPEAT) at.push_back(ev.at_us / 1000);
+  }
+  // First repeat after the delay, then every INPUT_REPEAT_MS (on the scan grid)
+  CHECK(at.size() >= 4);
+  if (at.empty()) return;
+  uint32_t pressMs = evs[0].at_us / 1000;
+  CHECK(at[0] - pressMs >= INPUT_REPEAT_DELAY_MS && at[0] - pressMs < INPUT_REPEAT_DELAY_MS + INPUT_SCAN_MS);
+  for (size_t i = 1; i < at.size(); i++) {
+    CHECK(at[i] - at[i - 1] >= INPUT_REPEAT_MS && at[i] - at[i - 1] < INPUT_REPEAT_MS + INPUT_SCAN_MS);
+  }
+}
+
+TEST(accept_key_does_not_repeat) {
+  startInput();
+  setKey(KEY_ACCEPT, true);
+  run(1500);
+  setKey(KEY_ACCEPT, false);
+  run(100);
+  std::vector<InputEvent> evs = takeEvents();
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_REPEAT), 0);
+  CHECK_EQ(evs.size(), 2);
+}
+
+// ---------- BENCHMARK ----------
+// The loops inputTask replaced: one task polling the matrix and one per
+// button, each every 10 ms with a 50 ms millis() debounce per key.
+struct BaselineKeypad {
+  bool buttonState[3][3] = {};
+  bool lastButtonState[3][3] = {};
+  unsigned long lastDebounceTime[3][3] = {};
+  int buttonLast[2] = { HIGH, HIGH };
+  int buttonStable[2] = { HIGH, HIGH };
+  unsigned long buttonDebounce[2] = {};
+  std::vector<uint32_t> pressMs;
+
+  void scanMatrix() {
+    const unsigned long debounceDelay = 50;
+    for (int row = 0; row < 3; row++) {
+      for (int i = 0; i < 3; i++) {
+        digitalWrite(rowPins[i], (i == row) ? LOW : HIGH);
+      }
+      delayMicroseconds(10);
+      for (int col = 0; col < 3; col++) {
+        bool reading = (digitalRead(colPins[col]) == LOW);
+        if (reading != lastButtonState[row][col]) {
+          lastDebounceTime[row][col] = millis();
+        }
+        if ((millis() - lastDebounceTime[row][col]) > debounceDelay) {
+          if (reading != buttonState[row][col]) {
+            buttonState[row][col] = reading;
+            if (reading) pressMs.push_back(millis());
+          }
+        }
+        lastButtonState[row][col] = reading;
+      }
+    }
+  }
+
+  void scanButton(int i, int pin) {
+    const unsigned long debounceDelay = 50;
+    int reading = digitalRead(pin);
+    if (reading != buttonLast[i]) buttonDebounce[i] = millis();
+    if ((millis() - buttonDebounce[i]) > debounceDelay && reading != buttonStable[i]) {
+      buttonStable[i] = reading;
+      if (reading == LOW) pressMs.push_back(millis());
+    }
+    buttonLast[i] = reading;
+  }
+};
+
+static uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// A minute at the counter: a handful of presses, mostly idle
+struct Press {
+  unsigned long at;
+  int key;
+  unsigned long holdMs;
+};
+
+static const Press session[] = {
+  { 2000, INPUT_KEY_MATRIX(0, 0), 120 },
+  { 2600, INPUT_KEY_MATRIX(0, 0), 90 },
+  { 4000, INPUT_KEY_MATRIX(1, 1), 150 },
+  { 9000, INPUT_KEY_CONFIRM, 200 },
+  { 15000, KEY_ACCEPT, 180 },
+  { 40000, INPUT_KEY_NEW_BREAD, 300 },
+};
+static const int sessionPresses = sizeof(session) / sizeof(session[0]);
+static const unsigned long sessionMs = 60000;
+
+TEST(scan_cost_vs_polling_loops) {
+  startInput();
+  run(200);
+  takeEvents();
+
+  // Baseline: drive the old loops off the same keypad model on a 10 ms tick
+  BaselineKeypad old;
+  pad.pinWrites = pad.pinReads = 0;
+  for (int i = 0; i < 3; i++) digitalWrite(rowPins[i], HIGH);
+  pad.pinWrites = 0;
+  uint32_t oldWakeups = 0;
+  uint64_t oldNs = 0;
+  unsigned long start = millis();
+  int next = 0;
+  for (unsigned long t = 0; t < sessionMs; t++) {
+    if (next < sessionPresses && t == session[next].at) {
+      pad.down[session[next].key] = true;
+      pad.bounceUntil[session[next].key] = millis() + 5;
+    }
+    for (int i = 0; i < next; i++) {
+      if (t == session[i].at + session[i].holdMs) pad.down[session[i].key] = false;
+    }
+    if (next < sessionPresses && t == session[next].at) next++;
+    if (t % 10 == 0) {
+      uint64_t t0 = nowNs();
+      old.scanMatrix();
+      old.scanButton(0, CONFIRM_BUTTON_PIN);
+      old.scanButton(1, NEW_BREAD_BUTTON_PIN);
+      oldNs += nowNs() - t0;
+      oldWakeups += 3;
+    }
+    hostAdvance(1);
+  }
+  uint32_t oldAccesses = pad.pinWrites + pad.pinReads;
+  uint32_t oldLatency = 0;
+  for (size_t i = 0; i < old.pressMs.size(); i++) oldLatency += old.pressMs[i] - start - session[i].at;
+  CHECK_EQ(old.pressMs.size(), sessionPresses);
+
+  // The row pins back to idle for inputTask
+  for (int i = 0; i < 3; i++) digitalWrite(rowPins[i], LOW);
+
+  // inputTask over the same session
+  getInputStats();
+  pad.regWrites = pad.regReads = 0;
+  start = millis();
+  next = 0;
+  for (unsigned long t = 0; t < sessionMs; t++) {
+    if (next < sessionPresses && t == session[next].at) {
+      setKey(session[next].key, true, 5);
+      next++;
+    }
+    for (int i = 0; i < next; i++) {
+      if (t == session[i].at + session[i].holdMs) setKey(session[i].key, false, 5);
+    }
+    run(1);
+  }
+  InputStats st = getInputStats();
+  uint32_t newAccesses = pad.regWrites + pad.regReads;
+  std::vector<InputEvent> evs = takeEvents();
+  CHECK_EQ(countEvents(evs, INPUT_EVENT_PRESS), sessionPresses);
+  uint32_t newLatency = 0;
+  int i = 0;
+  for (const InputEvent& ev : evs) {
+    if (ev.type != INPUT_EVENT_PRESS || i >= sessionPresses) continue;
+    newLatency += ev.at_us / 1000 - start - session[i++].at;
+  }
+
+  // Host ns include the keypad model behind every access; on the device
+  // the same split is reported as in_scan_cycles
+  printf("  polling loops: %5u wakeups, %6u gpio calls (%2u per scan), %4.0f host ns/scan, press latency %u ms\n",
+         oldWakeups, oldAccesses, oldAccesses * 3 / oldWakeups,
+         (double)oldNs * 3 / oldWakeups, oldLatency / sessionPresses);
+  printf("  inputTask    : %5u wakeups, %6u reg accesses (%2u per scan), %4u host ns/scan, press latency %u ms\n",
+         st.wakeups, newAccesses, st.wakeups ? newAccesses / st.wakeups : 0,
+         st.scan_avg_cycles, newLatency / sessionPresses);
+  CHECK(st.wakeups * 10 < oldWakeups);
+  CHECK(newAccesses * 10 < oldAccesses);
+  CHECK(newLatency < oldLatency);
+}
+
+TEST_MAIN()
@@ -0,0 +1,200 @@
+#include "test.h"
+#include "mqtt_ring.h"
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+
+static void drain() {
+  while (peekMqttSlot(0)) releaseMqttSlots(1);
+}
+
+static MqttQueueStats ringStats() {
+  MqttQueueStats st;
+  takeMqttRingStats(st);
+  return st;
+}
+
+TEST(fifo_across_wraparound) {
+  initMqttQueue();
+  char buf[16];
+  for (int round = 0; round < 5; round++) {
+    for (int i = 0; i < MQTT_RING_SIZE - 3; i++) {
+      int n = snprintf(buf, sizeof(buf), "m%d", round * 100 + i);
+      CHECK(queueMqttMessage(MQTT_TOPIC_STATS, buf, n));
+    }
+    CHECK_EQ(getMqttQueueSize(), MQTT_RING_SIZE - 3);
+    for (int i = 0; i < MQTT_RING_SIZE - 3; i++) {
+      MqttSlot* slot = peekMqttSlot(0);
+      CHECK(slot != NULL);
+      if (!slot) return;
+      snprintf(buf, sizeof(buf), "m%d", round * 100 + i);
+      CHECK(strcmp(slot->payload, buf) == 0);
+      CHECK_EQ(slot->topic, MQTT_TOPIC_STATS);
+      releaseMqttSlots(1);
+    }
+    CHECK(peekMqttSlot(0) == NULL);
+  }
+}
+
+TEST(full_ring_drops_newest) {
+  initMqttQueue();
+  MqttQueueStats before = ringStats();
+  for (int i = 0; i < MQTT_RING_SIZE; i++) {
+    CHECK(queueMqttMessage(MQTT_TOPIC_ERROR, String(i)));
+  }
+  CHECK(!queueMqttMessage(MQTT_TOPIC_ERROR, String("late")));
+  CHECK(!queueMqttMessage(MQTT_TOPIC_ERROR, String("later")));
+
+  MqttQueueStats after = ringStats();
+  CHECK_EQ(after.dropped - before.dropped, 2);
+  CHECK_EQ(after.enqueued - before.enqueued, MQTT_RING_SIZE);
+
+  // The oldest messages survive; the last slot still holds the last accepted one
+  CHECK(strcmp(peekMqttSlot(0)->payload, "0") == 0);
+  CHECK(strcmp(peekMqttSlot(MQTT_RING_SIZE - 1)->payload, String(MQTT_RING_SIZE - 1).c_str()) == 0);
+
+  // Releasing one slot makes room for exactly one more
+  releaseMqttSlots(1);
+  CHECK(queueMqttMessage(MQTT_TOPIC_ERROR, String("again")));
+  CHECK(!queueMqttMessage(MQTT_TOPIC_ERROR, String("full")));
+  drain();
+}
+
+TEST(oversized_payload_is_truncated) {
+  initMqttQueue();
+  MqttQueueStats before = ringStats();
+  std::string big(MQTT_SLOT_PAYLOAD_SIZE + 40, 'p');
+  CHECK(queueMqttMessage(MQTT_TOPIC_BREAD_TIME, big.c_str(), big.size(), true));
+  MqttSlot* slot = peekMqttSlot(0);
+  CHECK_EQ(slot->len, MQTT_SLOT_PAYLOAD_SIZE - 1);
+  CHECK_EQ(strlen(slot->payload), MQTT_SLOT_PAYLOAD_SIZE - 1);
+  CHECK(slot->retain);
+  CHECK_EQ(ringStats().truncated - before.truncated, 1);
+  drain();
+}
+
+// Four producers race one consumer; every message must arrive exactly once
+// and each producer's messages in the order it sent them
+TEST(concurrent_producers_single_consumer) {
+  initMqttQueue();
+  const int producers = 4;
+  const int perProducer = 20000;
+  std::atomic<int> rejected(0);
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([p, &rejected]() {
+      char buf[24];
+      for (int i = 0; i < perProducer; i++) {
+        int n = snprintf(buf, sizeof(buf), "%d:%d", p, i);
+        while (!queueMqttMessage(MQTT_TOPIC_STATS, buf, n)) {
+          rejected++;
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  int next[producers] = {0};
+  int received = 0;
+  bool ordered = true;
+  while (received < producers * perProducer) {
+    MqttSlot* slot = peekMqttSlot(0);
+    if (!slot) {
+      std::this_thread::yield();
+      continue;
+    }
+    int p, i;
+    if (sscanf(slot->payload, "%d:%d", &p, &i) != 2 || p < 0 || p >= producers || i != next[p]) {
+      ordered = false;
+    } else {
+      next[p]++;
+    }
+    releaseMqttSlots(1);
+    received++;
+  }
+  for (std::thread& t : threads) t.join();
+
+  CHECK(ordered);
+  for (int p = 0; p < producers; p++) CHECK_EQ(next[p], perProducer);
+  CHECK(peekMqttSlot(0) == NULL);
+  printf("  %d messages, %d full-ring retries\n", received, rejected.load());
+}
+
+// ---------- BENCHMARK ----------
+// The deque it replaced: two heap Strings per message behind a mutex
+struct DequeMessage {
+  String topic;
+  String payload;
+  bool retain;
+};
+
+static SemaphoreHandle_t dequeMutex;
+static std::deque<DequeMessage> dequeQueue;
+
+static bool dequeEnqueue(const String& topic, const String& payload, bool retain) {
+  if (xSemaphoreTake(dequeMutex, 2000) != pdTRUE) return false;
+  bool ok = dequeQueue.size() < MQTT_RING_SIZE;
+  if (ok) {
+    DequeMessage msg;
+    msg.topic = topic;
+    msg.payload = payload;
+    msg.retain = retain;
+    dequeQueue.push_back(msg);
+  }
+  xSemaphoreGive(dequeMutex);
+  return ok;
+}
+
+static uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TEST(enqueue_cost_ring_vs_deque) {
+  const int rounds = 2000;
+  const String topic("bakery/1/error");
+  const String payload("{\"code\":\"NET_HTTP_RETRIES\",\"detail\":-11,\"count\":3,\"uptime\":123456}");
+
+  initMqttQueue();
+  dequeMutex = xSemaphoreCreateMutex();
+
+  uint64_t ringNs = 0, dequeNs = 0;
+  size_t ringHeapLow = 0, dequeHeapLow = 0;
+  int ringAllocs = 0, dequeAllocs = 0;
+
+  for (int r = 0; r < rounds; r++) {
+    uint32_t heap = ESP.getFreeHeap();
+    uint64_t t0 = nowNs();
+    for (int i = 0; i < MQTT_RING_SIZE; i++) {
+      queueMqttMessage(MQTT_TOPIC_ERROR, payload.c_str(), payload.length(), true);
+    }
+    uint64_t t1 = nowNs();
+    ringNs += t1 - t0;
+    if (ESP.getFreeHeap() != heap) ringAllocs++;
+    ringHeapLow = std::max(ringHeapLow, (size_t)(heap - std::min(heap, ESP.getFreeHeap())));
+    drain();
+
+    heap = ESP.getFreeHeap();
+    t0 = nowNs();
+    for (int i = 0; i < MQTT_RING_SIZE; i++) {
+      dequeEnqueue(topic, payload, true);
+    }
+    t1 = nowNs();
+    dequeNs += t1 - t0;
+    if (ESP.getFreeHeap() != heap) dequeAllocs++;
+    dequeHeapLow = std::max(dequeHeapLow, (size_t)(heap - std::min(heap, ESP.getFreeHeap())));
+    dequeQueue.clear();
+  }
+
+  int n = rounds * MQTT_RING_SIZE;
+  printf("  ring : %6.1f ns/enqueue, %5zu B heap held at full, %d/%d rounds allocated\n",
+         (double)ringNs / n, ringHeapLow, ringAllocs, rounds);
+  printf("  deque: %6.1f ns/enqueue, %5zu B heap held at full, %d/%d rounds allocated\n",
+         (double)dequeNs / n, dequeHeapLow, dequeAllocs, rounds);
+  CHECK_EQ(ringAllocs, 0);
+  CHECK(dequeHeapLow > 0);
+}
+
+TEST_MAIN()
@@ -0,0 +1,217 @@
+#include "test.h"
+#include "printer.h"
+
+extern HardwareSerial printerSerial;
+
+// ---------- BASELINE ----------
+// printCustomerTicket() as it was before the templates: one UART write per
+// ESC/POS command. Used as the byte-for-byte reference.
+static HardwareSerial baselineSerial(2);
+
+template <size_t N>
+static void sendCommand(const byte (&command)[N]) {
+  baselineSerial.write(command, N);
+}
+
+template <size_t N>
+static void sendCommand(const byte (&command)[N], byte value) {
+  byte modifiedCommand[N];
+  for (size_t i = 0; i < N - 1; i++) modifiedCommand[i] = command[i];
+  modifiedCommand[N - 1] = value;
+  baselineSerial.write(modifiedCommand, N);
+}
+
+static const byte lineFeed[]          = {10};
+static const byte printAndFeedLines[] = {27, 100, 0};
+static const byte alignCenter[]       = {27, 97, 1};
+static const byte fontSize[]          = {29, 33, 0};
+static const byte boldOn[]            = {27, 69, 1};
+static const byte boldOff[]           = {27, 69, 0};
+static const byte qrModel[]      = {0x1D, 0x28, 0x6B, 0x04, 0x00, 0x31, 0x41, 0x32, 0x00};
+static const byte qrSize[]       = {0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x43, 0x06};
+static const byte qrErrorLevel[] = {0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x45, 0x31};
+static const byte qrPrint[]      = {0x1D, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x51, 0x30};
+
+static void printQRCode(const char* data) {
+  sendCommand(qrModel);
+  sendCommand(qrSize);
+  sendCommand(qrErrorLevel);
+  int dataLength = strlen(data);
+  int pL = (dataLength + 3) % 256;
+  int pH = (dataLength + 3) / 256;
+  byte qrDataHeader[] = {0x1D, 0x28, 0x6B, (byte)pL, (byte)pH, 0x31, 0x50, 0x30};
+  sendCommand(qrDataHeader);
+  baselineSerial.write((const uint8_t*)data, dataLength);
+  sendCommand(qrPrint);
+  sendCommand(lineFeed);
+}
+
+static std::string baselineTicket(int bakeryId, int ticketId) {
+  baselineSerial.output.clear();
+  baselineSerial.writeCalls = 0;
+
+  sendCommand(alignCenter);
+  sendCommand(fontSize, 0x00);
+  baselineSerial.println("Customer ID");
+  sendCommand(lineFeed);
+  sendCommand(boldOn);
+  sendCommand(fontSize, 0x11);
+  char idBuffer[16];
+  snprintf(idBuffer, sizeof(idBuffer), "%d", ticketId);
+  baselineSerial.println(idBuffer);
+  sendCommand(boldOff);
+  sendCommand(fontSize, 0x00);
+  sendCommand(printAndFeedLines, 2);
+  char urlBuffer[96];
+  snprintf(urlBuffer, sizeof(urlBuffer), "https://noonyar.ir/res/?b=%d&t=%d", bakeryId, ticketId);
+  printQRCode(urlBuffer);
+  sendCommand(printAndFeedLines, 3);
+  return baselineSerial.output;
+}
+
+// ---------- HELPERS ----------
+static void startPrinter() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  initPrinter();
+  xTaskCreatePinnedToCore(printerTask, "Printer", 4096, NULL, 1, NULL, 1);
+  hostAdvance(200);
+  CHECK_EQ(printerSerial.baud, PRINTER_BAUD);
+  CHECK(printerSerial.output == std::string("\x1b@", 2));
+}
+
+// Lets the printer drain its queue and returns what it sent
+static std::string printed() {
+  hostAdvance(5000);
+  printerSerial.writeCalls = 0;
+  std::string out;
+  out.swap(printerSerial.output);
+  return out;
+}
+
+static size_t countOf(const std::string& s, const std::string& what) {
+  size_t n = 0;
+  for (size_t at = s.find(what); at != std::string::npos; at = s.find(what, at + 1)) n++;
+  return n;
+}
+
+// Every header must be followed by its ticket body or by a VOID before the
+// next header starts
+static bool everyHeaderClosed(const std::string& out) {
+  size_t at = 0;
+  while ((at = out.find("Customer ID", at)) != std::string::npos) {
+    size_t next = out.find("Customer ID", at + 1);
+    size_t url = out.find("https://noonyar.ir/res/", at);
+    size_t voided = out.find("NOT ISSUED", at);
+    size_t closedAt = std::min(url, voided);
+    if (closedAt == std::string::npos || closedAt > next) return false;
+    at++;
+  }
+  return true;
+}
+
+// ---------- RENDERING ----------
+TEST(whole_ticket_matches_baseline_bytes) {
+  startPrinter();
+  printed();
+  const int ids[] = { 0, 7, 42, 999, 123456789 };
+  for (int id : ids) {
+    CHECK(printerFinishTicket(3, id, false));
+    std::string got = printed();
+    std::string want = baselineTicket(3, id);
+    CHECK(got == want);
+  }
+}
+
+TEST(split_ticket_matches_baseline_bytes) {
+  startPrinter();
+  printed();
+  CHECK(printerBeginTicket());
+  hostAdvance(20);
+  std::string header = printerSerial.output;
+  CHECK(printerFinishTicket(12, 3456, true));
+  std::string got = printed();
+  CHECK(got == baselineTicket(12, 3456));
+  CHECK(header.size() > 0 && header.size() < got.size());
+}
+
+TEST(void_closes_a_begun_header) {
+  startPrinter();
+  printed();
+  CHECK(printerBeginTicket());
+  CHECK(printerVoidTicket());
+  std::string out = printed();
+  CHECK_EQ(countOf(out, "Customer ID"), 1);
+  CHECK_EQ(countOf(out, "-- NOT ISSUED --"), 1);
+  CHECK(everyHeaderClosed(out));
+}
+
+// ---------- FULL QUEUE ----------
+// The printer is busy on the first header while orders keep coming: the
+// BEGIN that would take the last free slot is refused, so no FINISH is
+// ever dropped behind a header already queued
+TEST(full_queue_never_orphans_a_header) {
+  startPrinter();
+  printed();
+  getPrinterStats();
+
+  int begunOk = 0, finished = 0, notPrinted = 0;
+  for (int order = 0; order < 8; order++) {
+    bool begun = printerBeginTicket();
+    if (begun) begunOk++;
+    if (order == 0) hostSettle();   // the printer task takes the first header
+    if (printerFinishTicket(1, 100 + order, begun)) finished++;
+    else notPrinted++;
+  }
+
+  PrinterStats st = getPrinterStats();
+  // Orders 1-4 fit as header + body (order 0's header is on the printer);
+  // then one whole ticket still fits the last slot, the rest are refused
+  CHECK_EQ(begunOk, PRINTER_QUEUE_DEPTH / 2);
+  CHECK_EQ(finished, begunOk + 1);
+  CHECK(st.dropped > 0);
+
+  std::string out = printed();
+  CHECK(everyHeaderClosed(out));
+  CHECK_EQ(countOf(out, "Customer ID"), finished);
+  CHECK_EQ(countOf(out, "https://noonyar.ir/res/"), finished);
+  CHECK_EQ(notPrinted, 8 - finished);
+}
+
+// ---------- THROUGHPUT ----------
+TEST(tickets_per_minute_at_printer_baud) {
+  startPrinter();
+  printed();
+  getPrinterStats();
+
+  const int tickets = 20;
+  uint32_t baselineWrites = 0;
+  size_t ticketBytes = 0;
+  for (int i = 0; i < tickets; i++) {
+    CHECK(printerBeginTicket());
+    CHECK(printerFinishTicket(1, 1000 + i, true));
+    hostAdvance(200);
+    ticketBytes = baselineTicket(1, 1000 + i).size();
+    baselineWrites += baselineSerial.writeCalls;
+  }
+  uint32_t templateWrites = printerSerial.writeCalls;
+  std::string out = printed();
+  PrinterStats st = getPrinterStats();
+
+  CHECK_EQ(st.tickets, tickets);
+  CHECK_EQ(st.bytes, out.size());
+  CHECK(everyHeaderClosed(out));
+
+  // Two jobs per ticket, each rounded up to whole milliseconds on the wire
+  uint32_t wireMs = (uint32_t)(ticketBytes * 10 * 1000 / PRINTER_BAUD);
+  uint32_t ideal = 60000 / wireMs;
+  printf("  %zu B/ticket at %d baud: %u tickets/min (ideal %u), %.1f UART writes/ticket (baseline %.1f)\n",
+         ticketBytes, PRINTER_BAUD, st.capacity_tpm, ideal,
+         (double)templateWrites / tickets, (double)baselineWrites / tickets);
+  CHECK(st.capacity_tpm <= ideal && st.capacity_tpm + ideal / 20 >= ideal);
+  CHECK_EQ(templateWrites, 2 * tickets);
+}
+
+TEST_MAIN()
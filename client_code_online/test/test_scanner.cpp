@@ -0,0 +1,102 @@
+#include "test.h"
+#include "scanner.h"
+#include <vector>
+
+// The UART driver raises the callback once the scanner stops sending
+static void scan(const std::string& bytes) {
+  Serial.inject(bytes);
+  Serial.raiseReceive();
+}
+
+static std::vector<int> takeTickets() {
+  std::vector<int> out;
+  ScanTicket t;
+  while (scannerNextTicket(t, 0)) out.push_back(t.ticket_id);
+  return out;
+}
+
+static void startScanner() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+  initScanner();
+  getScannerStats();
+}
+
+TEST(registers_for_rx_timeout) {
+  startScanner();
+  CHECK(Serial.receiveCb != nullptr);
+  CHECK(Serial.receiveOnTimeout);
+  CHECK_EQ(Serial.rxTimeout, SCANNER_RX_TIMEOUT);
+}
+
+TEST(terminated_codes) {
+  startScanner();
+  scan("https://noonyar.ir/res/?b=1&t=42\r\n");
+  scan("t=7\n");
+  std::vector<int> got = takeTickets();
+  CHECK_EQ(got.size(), 2);
+  if (got.size() == 2) {
+    CHECK_EQ(got[0], 42);
+    CHECK_EQ(got[1], 7);
+  }
+  ScannerStats st = getScannerStats();
+  CHECK_EQ(st.scans, 2);
+  CHECK_EQ(st.malformed, 0);
+}
+
+// The baseline readStringUntil('\n') also returned on its timeout
+TEST(code_without_terminator_ends_on_idle) {
+  startScanner();
+  scan("https://noonyar.ir/res/?b=1&t=314");
+  std::vector<int> got = takeTickets();
+  CHECK_EQ(got.size(), 1);
+  if (!got.empty()) CHECK_EQ(got[0], 314);
+}
+
+TEST(garbled_tail_is_not_prefixed_onto_next_scan) {
+  startScanner();
+  getScannerStats();
+  scan("\x11\x8f~noise");
+  scan("t=55\r\n");
+  std::vector<int> got = takeTickets();
+  CHECK_EQ(got.size(), 1);
+  if (!got.empty()) CHECK_EQ(got[0], 55);
+  ScannerStats st = getScannerStats();
+  CHECK_EQ(st.malformed, 1);
+  CHECK_EQ(st.scans, 1);
+}
+
+TEST(burst_with_several_codes) {
+  startScanner();
+  scan("t=1\r\nt=2\r\n\r\nt=3");
+  std::vector<int> got = takeTickets();
+  CHECK_EQ(got.size(), 3);
+  if (got.size() == 3) CHECK(got[0] == 1 && got[1] == 2 && got[2] == 3);
+}
+
+TEST(other_bakery_and_overlong_lines) {
+  startScanner();
+  getScannerStats();
+  scan("https://noonyar.ir/res/?b=9&t=5\r\n");
+  scan(std::string("t=") + std::string(SCANNER_LINE_MAX, '1') + "\r\n");
+  scan("t=8\r\n");
+  std::vector<int> got = takeTickets();
+  CHECK_EQ(got.size(), 1);
+  if (!got.empty()) CHECK_EQ(got[0], 8);
+  ScannerStats st = getScannerStats();
+  CHECK_EQ(st.other_bakery, 1);
+  CHECK_EQ(st.malformed, 1);
+}
+
+TEST(full_queue_counts_drops) {
+  startScanner();
+  getScannerStats();
+  for (int i = 0; i < SCANNER_QUEUE_DEPTH + 2; i++) scan("t=" + std::to_string(i) + "\n");
+  CHECK_EQ(takeTickets().size(), SCANNER_QUEUE_DEPTH);
+  ScannerStats st = getScannerStats();
+  CHECK_EQ(st.scans, SCANNER_QUEUE_DEPTH);
+  CHECK_EQ(st.dropped, 2);
+}
+
+TEST_MAIN()